@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/trpc_bench.dir/micro_bench.cpp.o"
+  "CMakeFiles/trpc_bench.dir/micro_bench.cpp.o.d"
+  "trpc_bench"
+  "trpc_bench.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/trpc_bench.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/trpc_loadgen.dir/loadgen.cpp.o"
+  "CMakeFiles/trpc_loadgen.dir/loadgen.cpp.o.d"
+  "trpc_loadgen"
+  "trpc_loadgen.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/trpc_loadgen.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
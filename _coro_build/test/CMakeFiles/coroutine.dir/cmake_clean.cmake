@@ -0,0 +1,11 @@
+file(REMOVE_RECURSE
+  "CMakeFiles/coroutine.dir/coroutine.cpp.o"
+  "CMakeFiles/coroutine.dir/coroutine.cpp.o.d"
+  "coroutine"
+  "coroutine.pdb"
+)
+
+# Per-language clean rules from dependency scanning.
+foreach(lang CXX)
+  include(CMakeFiles/coroutine.dir/cmake_clean_${lang}.cmake OPTIONAL)
+endforeach()
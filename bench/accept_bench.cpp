@@ -0,0 +1,138 @@
+// 建连速率压测: 多个客户端线程反复 connect + 立即关闭 (RST, 不留 TIME_WAIT),
+// 对比单 acceptor 轮转分配与每个 io_context 一个 SO_REUSEPORT acceptor 两种模式。
+//
+// usage: trpc_accept_bench [--mode=single|reuse_port|both] [--duration=S] [--clients=N]
+//                          [--pool=N] [--port=P]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "clog/clog.h"
+#include "histogram.hpp"
+#include "trpc/rpc_server.hpp"
+
+using namespace trpc;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+struct Options {
+    std::string mode = "both";
+    double duration = 5;
+    size_t clients = 8;
+    size_t pool = 4;
+    unsigned short port = 16667;
+};
+
+Options parse_options(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto eq = arg.find('=');
+        if (arg.rfind("--", 0) != 0 || eq == std::string::npos) {
+            std::fprintf(stderr, "invalid argument: %s\n", arg.c_str());
+            std::exit(1);
+        }
+        std::string key = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+        if (key == "mode") {
+            opt.mode = value;
+        } else if (key == "duration") {
+            opt.duration = std::stod(value);
+        } else if (key == "clients") {
+            opt.clients = std::max<size_t>(std::stoul(value), 1);
+        } else if (key == "pool") {
+            opt.pool = std::max<size_t>(std::stoul(value), 1);
+        } else if (key == "port") {
+            opt.port = static_cast<unsigned short>(std::stoul(value));
+        } else {
+            std::fprintf(stderr, "unknown option: --%s\n", key.c_str());
+            std::exit(1);
+        }
+    }
+    if (opt.mode != "single" && opt.mode != "reuse_port" && opt.mode != "both") {
+        std::fprintf(stderr, "invalid mode: %s\n", opt.mode.c_str());
+        std::exit(1);
+    }
+    return opt;
+}
+
+void run_client(const Options& opt,
+                clock_type::time_point end,
+                bench::LatencyHistogram& histogram,
+                std::atomic<uint64_t>& failures) {
+    asio::io_context io_service;
+    tcp::endpoint endpoint(asio::ip::address_v4::loopback(), opt.port);
+    while (clock_type::now() < end) {
+        tcp::socket socket(io_service);
+        asio::error_code ec;
+        auto start = clock_type::now();
+        socket.connect(endpoint, ec);
+        if (ec) {
+            failures.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        histogram.record(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now() - start)
+                .count());
+        socket.set_option(asio::socket_base::linger(true, 0), ec);
+        socket.close(ec);
+    }
+}
+
+void run_mode(const Options& opt, bool reuse_port) {
+    ServerOptions server_options;
+    server_options.reuse_port = reuse_port;
+    auto server = std::make_unique<RpcServer>(opt.port, opt.pool, server_options);
+    std::thread server_thread([&server] { server->run(); });
+
+    std::vector<bench::LatencyHistogram> histograms(opt.clients);
+    std::atomic<uint64_t> failures{0};
+    auto start = clock_type::now();
+    auto end = start + std::chrono::duration_cast<clock_type::duration>(
+                           std::chrono::duration<double>(opt.duration));
+    std::vector<std::thread> clients;
+    for (size_t i = 0; i < opt.clients; ++i) {
+        clients.emplace_back(run_client, std::cref(opt), end, std::ref(histograms[i]),
+                             std::ref(failures));
+    }
+    for (auto& t : clients) {
+        t.join();
+    }
+    double elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+    uint64_t accepted = server->stats().accepted.load();
+    server->stop();
+    server_thread.join();
+    server.reset();
+
+    bench::LatencyHistogram total;
+    for (auto& h : histograms) {
+        total.merge(h);
+    }
+    std::printf("%-10s accepted: %llu (%.0f conn/s), failed connects: %llu, connect latency us: "
+                "p50 %.1f, p99 %.1f, max %.1f\n",
+                reuse_port ? "reuse_port" : "single", static_cast<unsigned long long>(accepted),
+                accepted / elapsed, static_cast<unsigned long long>(failures.load()),
+                total.percentile(50) / 1000.0, total.percentile(99) / 1000.0,
+                total.max() / 1000.0);
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    clog::setLogLevel(clog::LogLevel::ERROR);
+    Options opt = parse_options(argc, argv);
+    std::printf("duration: %.1fs, clients: %zu, server pool: %zu\n", opt.duration, opt.clients,
+                opt.pool);
+    if (opt.mode != "reuse_port") {
+        run_mode(opt, false);
+    }
+    if (opt.mode != "single") {
+        run_mode(opt, true);
+    }
+}
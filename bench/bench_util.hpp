@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace trpc {
+namespace bench {
+
+// 由 micro_bench.cpp 中替换的 malloc / memcpy 统计
+struct Counters {
+    std::atomic<uint64_t> allocs{0};
+    std::atomic<uint64_t> alloc_bytes{0};
+    std::atomic<uint64_t> copied_bytes{0};
+};
+
+Counters& counters();
+
+struct Snapshot {
+    uint64_t allocs;
+    uint64_t alloc_bytes;
+    uint64_t copied_bytes;
+
+    static Snapshot take() {
+        auto& c = counters();
+        return {c.allocs.load(std::memory_order_relaxed),
+                c.alloc_bytes.load(std::memory_order_relaxed),
+                c.copied_bytes.load(std::memory_order_relaxed)};
+    }
+};
+
+template <typename T>
+inline void do_not_optimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline void clobber_memory() { asm volatile("" : : : "memory"); }
+
+struct Result {
+    std::string name;
+    uint64_t iterations;
+    double ns_per_op;
+    double allocs_per_op;
+    double alloc_bytes_per_op;
+    double copied_bytes_per_op;
+};
+
+inline void print_header() {
+    std::printf("%-44s %12s %12s %10s %12s %12s\n", "benchmark", "iterations", "ns/op",
+                "allocs/op", "alloc B/op", "copied B/op");
+}
+
+inline void print_result(const Result& r) {
+    std::printf("%-44s %12llu %12.1f %10.2f %12.1f %12.1f\n", r.name.c_str(),
+                static_cast<unsigned long long>(r.iterations), r.ns_per_op, r.allocs_per_op,
+                r.alloc_bytes_per_op, r.copied_bytes_per_op);
+}
+
+// 自动扩大迭代次数，直到单轮运行时间超过 min_time
+template <typename F>
+Result run(const std::string& name,
+           F&& f,
+           std::chrono::milliseconds min_time = std::chrono::milliseconds(200)) {
+    using clock = std::chrono::steady_clock;
+    for (int i = 0; i < 16; ++i) { // warm up
+        f();
+    }
+    uint64_t iterations = 1;
+    while (true) {
+        Snapshot before = Snapshot::take();
+        auto start = clock::now();
+        for (uint64_t i = 0; i < iterations; ++i) {
+            f();
+            clobber_memory();
+        }
+        auto elapsed = clock::now() - start;
+        Snapshot after = Snapshot::take();
+        if (elapsed >= min_time || iterations >= (1ull << 32)) {
+            double n = static_cast<double>(iterations);
+            Result r{name,
+                     iterations,
+                     std::chrono::duration<double, std::nano>(elapsed).count() / n,
+                     (after.allocs - before.allocs) / n,
+                     (after.alloc_bytes - before.alloc_bytes) / n,
+                     (after.copied_bytes - before.copied_bytes) / n};
+            print_result(r);
+            return r;
+        }
+        iterations *= 2;
+    }
+}
+
+} // namespace bench
+} // namespace trpc
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace trpc {
+namespace bench {
+
+// HDR 风格的对数-线性直方图: 每个 2 的幂区间划分为 64 个线性子桶，相对误差 < 1.6%。
+// 记录为 O(1)，不分配内存；多个直方图可以合并。
+class LatencyHistogram {
+public:
+    static constexpr int kSubBits = 7;
+    static constexpr uint64_t kSubCount = 1ull << kSubBits;
+    static constexpr uint64_t kHalfSub = kSubCount / 2;
+    static constexpr size_t kBuckets = (64 - kSubBits + 1) * kHalfSub + kSubCount;
+
+    void record(uint64_t value) {
+        ++counts_[bucket_of(value)];
+        ++total_;
+        min_ = std::min(min_, value);
+        max_ = std::max(max_, value);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (size_t i = 0; i < kBuckets; ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        total_ += other.total_;
+        min_ = std::min(min_, other.min_);
+        max_ = std::max(max_, other.max_);
+    }
+
+    uint64_t count() const { return total_; }
+    uint64_t min() const { return total_ == 0 ? 0 : min_; }
+    uint64_t max() const { return max_; }
+
+    // 返回 percentile (0~100) 所在桶的上界，与 HdrHistogram 的 "highest equivalent value" 一致
+    uint64_t percentile(double p) const {
+        if (total_ == 0) {
+            return 0;
+        }
+        auto target = static_cast<uint64_t>(p / 100.0 * static_cast<double>(total_) + 0.5);
+        target = std::clamp<uint64_t>(target, 1, total_);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += counts_[i];
+            if (seen >= target) {
+                return std::min(upper_bound_of(i), max_);
+            }
+        }
+        return max_;
+    }
+
+private:
+    static size_t bucket_of(uint64_t value) {
+        if (value < kSubCount) {
+            return static_cast<size_t>(value);
+        }
+        int msb = 63 - __builtin_clzll(value);
+        int exp = msb - (kSubBits - 1);
+        return static_cast<size_t>(exp * kHalfSub + (value >> exp));
+    }
+
+    static uint64_t upper_bound_of(size_t bucket) {
+        if (bucket < kSubCount) {
+            return bucket;
+        }
+        uint64_t exp = bucket / kHalfSub - 1;
+        uint64_t mantissa = bucket % kHalfSub + kHalfSub;
+        return ((mantissa + 1) << exp) - 1;
+    }
+
+    std::array<uint64_t, kBuckets> counts_{};
+    uint64_t total_{0};
+    uint64_t min_{std::numeric_limits<uint64_t>::max()};
+    uint64_t max_{0};
+};
+
+} // namespace bench
+} // namespace trpc
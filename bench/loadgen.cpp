@@ -0,0 +1,414 @@
+// 开环压测工具: 按固定目标速率发送请求，延迟从 "计划发送时间" 开始计算，
+// 因此服务端或客户端的排队都会如实体现在尾延迟中 (避免 coordinated omission)。
+//
+// usage: trpc_loadgen [--rate=N] [--duration=S] [--connections=N] [--senders=N]
+//                     [--payload=64,1024] [--mix=echo:90,add:10] [--pool=N]
+//                     [--host=IP] [--port=P] [--timeout_ms=N] [--spin_pool=N]
+//                     [--client_threads=N] [--pin=auto|0,2,4] [--balance_ms=N]
+//                     [--compress=N]
+// 未指定 --host 时在进程内启动一个 loopback RpcServer。
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "clog/clog.h"
+#include "histogram.hpp"
+#include "trpc/rpc_client.hpp"
+#include "trpc/rpc_server.hpp"
+
+using namespace trpc;
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+struct Options {
+    double rate = 10000;
+    double duration = 10;
+    size_t connections = 4;
+    size_t senders = 1;
+    std::vector<size_t> payloads{64};
+    std::vector<std::pair<std::string, unsigned>> mix{{"echo", 100}};
+    size_t pool = 2;
+    std::string host;
+    unsigned short port = 16666;
+    size_t timeout_ms = 2000;
+    size_t max_outstanding = 50000; // 也用作每个 RpcClient 的 max_pending_calls
+    size_t spin_pool = 0;      // >0 时 spin 在独立的 WorkerPool 中执行
+    size_t client_threads = 0; // >0 时所有连接共享 N 个 io 线程, 否则每个连接一个
+    bool pin = false;          // loopback 服务端的 io 线程绑定到 CPU
+    std::vector<int> pin_cpus; // 为空时使用 IoServicePool::default_cpus()
+    size_t balance_ms = 0;     // >0 时 loopback 服务端按此周期在 io 线程间迁移连接
+    size_t compress = 0;       // >0 时客户端与 loopback 服务端压缩不小于 N 字节的 body
+};
+
+std::vector<std::string> split(const std::string& s, char sep) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (start <= s.size()) {
+        size_t pos = s.find(sep, start);
+        if (pos == std::string::npos) {
+            pos = s.size();
+        }
+        if (pos > start) {
+            parts.push_back(s.substr(start, pos - start));
+        }
+        start = pos + 1;
+    }
+    return parts;
+}
+
+Options parse_options(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto eq = arg.find('=');
+        if (arg.rfind("--", 0) != 0 || eq == std::string::npos) {
+            std::fprintf(stderr, "invalid argument: %s\n", arg.c_str());
+            std::exit(1);
+        }
+        std::string key = arg.substr(2, eq - 2);
+        std::string value = arg.substr(eq + 1);
+        if (key == "rate") {
+            opt.rate = std::stod(value);
+        } else if (key == "duration") {
+            opt.duration = std::stod(value);
+        } else if (key == "connections") {
+            opt.connections = std::stoul(value);
+        } else if (key == "senders") {
+            opt.senders = std::stoul(value);
+        } else if (key == "payload") {
+            opt.payloads.clear();
+            for (auto& p : split(value, ',')) {
+                opt.payloads.push_back(std::stoul(p));
+            }
+        } else if (key == "mix") {
+            opt.mix.clear();
+            for (auto& item : split(value, ',')) {
+                auto colon = item.find(':');
+                unsigned weight =
+                    colon == std::string::npos ? 1 : std::stoul(item.substr(colon + 1));
+                opt.mix.emplace_back(item.substr(0, colon), weight);
+            }
+        } else if (key == "pool") {
+            opt.pool = std::stoul(value);
+        } else if (key == "host") {
+            opt.host = value;
+        } else if (key == "port") {
+            opt.port = static_cast<unsigned short>(std::stoul(value));
+        } else if (key == "timeout_ms") {
+            opt.timeout_ms = std::stoul(value);
+        } else if (key == "max_outstanding") {
+            opt.max_outstanding = std::stoul(value);
+        } else if (key == "spin_pool") {
+            opt.spin_pool = std::stoul(value);
+        } else if (key == "client_threads") {
+            opt.client_threads = std::stoul(value);
+        } else if (key == "balance_ms") {
+            opt.balance_ms = std::stoul(value);
+        } else if (key == "compress") {
+            opt.compress = std::stoul(value);
+        } else if (key == "pin") {
+            opt.pin = true;
+            if (value != "auto") {
+                opt.pin_cpus = IoServicePool::parse_cpu_list(value);
+            }
+        } else {
+            std::fprintf(stderr, "unknown option: --%s\n", key.c_str());
+            std::exit(1);
+        }
+    }
+    opt.connections = std::max<size_t>(opt.connections, 1);
+    opt.senders = std::clamp<size_t>(opt.senders, 1, opt.connections);
+    if (opt.payloads.empty() || opt.mix.empty() || opt.rate <= 0) {
+        std::fprintf(stderr, "invalid payload/mix/rate\n");
+        std::exit(1);
+    }
+    return opt;
+}
+
+// 每个连接的统计只在该 RpcClient 的 io 线程中修改
+struct ConnStats {
+    bench::LatencyHistogram histogram;
+    std::atomic<uint64_t> completed{0};
+    std::atomic<uint64_t> errors{0};
+    std::atomic<uint64_t> outstanding{0};
+};
+
+struct Target {
+    std::unique_ptr<RpcClient> client;
+    std::unique_ptr<ConnStats> stats;
+};
+
+void start_loopback_server(RpcServer& server, size_t spin_pool) {
+    server.register_handler("echo", [](const std::string& s) { return s; });
+    server.register_handler("add", [](int a, int b) { return a + b; });
+    // 模拟 CPU 密集型 handler
+    auto spin = [](int micros) {
+        auto end = clock_type::now() + std::chrono::microseconds(micros);
+        uint64_t n = 0;
+        while (clock_type::now() < end) {
+            ++n;
+        }
+        return n;
+    };
+    if (spin_pool > 0) {
+        HandlerOptions options;
+        options.executor = HandlerOptions::Executor::DEDICATED_POOL;
+        options.threads = spin_pool;
+        options.max_queue = 65536;
+        server.register_handler("spin", spin, options);
+    } else {
+        server.register_handler("spin", spin);
+    }
+}
+
+void send_one(Target& target,
+              const std::string& name,
+              FuncId func,
+              const std::string& payload,
+              clock_type::time_point intended) {
+    auto* stats = target.stats.get();
+    stats->outstanding.fetch_add(1, std::memory_order_relaxed);
+    auto on_result = [stats, intended](RpcResult result) {
+        auto latency = clock_type::now() - intended;
+        if (result.status().ok()) {
+            stats->histogram.record(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+            stats->completed.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            stats->errors.fetch_add(1, std::memory_order_relaxed);
+        }
+        stats->outstanding.fetch_sub(1, std::memory_order_relaxed);
+    };
+    if (name == "echo") {
+        target.client->async_call(func, std::move(on_result), payload);
+    } else if (name == "spin") {
+        target.client->async_call(func, std::move(on_result), 50);
+    } else {
+        target.client->async_call(func, std::move(on_result), 1, 2);
+    }
+}
+
+// 第 k 个发送线程负责 connections 中下标 % senders == k 的连接，速率为 rate / senders
+void run_sender(size_t k,
+                const Options& opt,
+                std::vector<Target>& targets,
+                const std::vector<std::string>& payloads,
+                clock_type::time_point start,
+                std::atomic<uint64_t>& sent,
+                std::atomic<uint64_t>& dropped) {
+    std::vector<Target*> mine;
+    for (size_t i = k; i < targets.size(); i += opt.senders) {
+        mine.push_back(&targets[i]);
+    }
+    unsigned total_weight = 0;
+    std::vector<FuncId> ids; // 预先计算函数 id, 发送时不再计算哈希
+    for (auto& [name, weight] : opt.mix) {
+        total_weight += weight;
+        ids.push_back(func_id(name));
+    }
+    std::mt19937 rng(static_cast<unsigned>(k) + 1);
+    auto period = std::chrono::duration<double, std::nano>(1e9 * opt.senders / opt.rate);
+    auto offset = period * (static_cast<double>(k) / opt.senders);
+    auto end = start + std::chrono::duration_cast<clock_type::duration>(
+                           std::chrono::duration<double>(opt.duration));
+    for (uint64_t i = 0;; ++i) {
+        auto intended =
+            start + std::chrono::duration_cast<clock_type::duration>(offset + period * i);
+        if (intended >= end) {
+            break;
+        }
+        // 落后于计划时直接发送，不补偿等待，延迟仍按计划时间统计
+        if (clock_type::now() < intended) {
+            std::this_thread::sleep_until(intended);
+        }
+        Target& target = *mine[i % mine.size()];
+        if (target.stats->outstanding.load(std::memory_order_relaxed) >= opt.max_outstanding) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        unsigned pick = rng() % total_weight;
+        size_t func = opt.mix.size() - 1;
+        for (size_t j = 0; j < opt.mix.size(); ++j) {
+            if (pick < opt.mix[j].second) {
+                func = j;
+                break;
+            }
+            pick -= opt.mix[j].second;
+        }
+        send_one(target, opt.mix[func].first, ids[func], payloads[rng() % payloads.size()],
+                 intended);
+        sent.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+double to_us(uint64_t ns) { return static_cast<double>(ns) / 1000.0; }
+} // namespace
+
+int main(int argc, char** argv) {
+    clog::setLogLevel(clog::LogLevel::ERROR);
+    Options opt = parse_options(argc, argv);
+
+    std::unique_ptr<RpcServer> server;
+    std::thread server_thread;
+    std::string host = opt.host;
+    if (host.empty()) {
+        host = "127.0.0.1";
+        ServerOptions server_options;
+        server_options.io_options.pin_threads = opt.pin;
+        server_options.io_options.cpus = opt.pin_cpus;
+        server_options.balance.interval_ms = opt.balance_ms;
+        server_options.compression = {opt.compress > 0, opt.compress};
+        server = std::make_unique<RpcServer>(opt.port, opt.pool, server_options);
+        start_loopback_server(*server, opt.spin_pool);
+        server_thread = std::thread([&server] { server->run(); });
+    }
+
+    std::unique_ptr<IoServicePool> client_io;
+    std::thread client_io_thread;
+    if (opt.client_threads > 0) {
+        client_io = std::make_unique<IoServicePool>(opt.client_threads);
+        client_io_thread = std::thread([&client_io] { client_io->run(); });
+    }
+    std::vector<Target> targets(opt.connections);
+    for (auto& target : targets) {
+        target.client =
+            client_io ? std::make_unique<RpcClient>(client_io->next_io_service(), host, opt.port,
+                                                    opt.max_outstanding)
+                      : std::make_unique<RpcClient>(host, opt.port, opt.max_outstanding);
+        target.stats = std::make_unique<ConnStats>();
+        target.client->set_default_timeout(std::chrono::milliseconds(opt.timeout_ms));
+        target.client->set_compression({opt.compress > 0, opt.compress});
+        if (!target.client->connect()) {
+            std::fprintf(stderr, "cannot connect to %s:%u\n", host.c_str(), opt.port);
+            return 1;
+        }
+    }
+    std::vector<std::string> payloads;
+    for (size_t size : opt.payloads) {
+        payloads.emplace_back(size, 'x');
+    }
+
+    std::printf("target rate: %.0f req/s, duration: %.1fs, connections: %zu, senders: %zu, "
+                "server pool: %zu\n",
+                opt.rate, opt.duration, opt.connections, opt.senders, opt.pool);
+
+    std::atomic<uint64_t> sent{0};
+    std::atomic<uint64_t> dropped{0};
+    auto start = clock_type::now() + std::chrono::milliseconds(10);
+    std::vector<std::thread> senders;
+    for (size_t k = 0; k < opt.senders; ++k) {
+        senders.emplace_back(run_sender, k, std::cref(opt), std::ref(targets), std::cref(payloads),
+                             start, std::ref(sent), std::ref(dropped));
+    }
+    for (auto& t : senders) {
+        t.join();
+    }
+    auto send_end = clock_type::now();
+
+    // 等待尚未返回的请求; 调用在 timeout_ms 后以超时失败, 再多等 1s 仍未完成视为丢失
+    auto drain_deadline = send_end + std::chrono::milliseconds(opt.timeout_ms + 1000);
+    auto outstanding = [&targets] {
+        uint64_t n = 0;
+        for (auto& t : targets) {
+            n += t.stats->outstanding.load(std::memory_order_relaxed);
+        }
+        return n;
+    };
+    while (outstanding() > 0 && clock_type::now() < drain_deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto end = clock_type::now();
+    uint64_t lost = outstanding();
+
+    // 先销毁客户端 (停止 io 线程) 再读取直方图
+    bench::LatencyHistogram total;
+    uint64_t completed = 0;
+    uint64_t errors = 0;
+    uint64_t client_batches = 0;
+    uint64_t client_frames = 0;
+    uint64_t client_expired = 0;
+    uint64_t client_saved = 0;
+    uint64_t client_compress_cpu_ns = 0;
+    for (auto& target : targets) {
+        client_expired += target.client->stats().expired.load();
+        client_saved += target.client->stats().bytes_saved();
+        client_compress_cpu_ns += target.client->stats().compress_cpu_ns.load() +
+                                  target.client->stats().decompress_cpu_ns.load();
+        client_batches += target.client->stats().write_batches.load();
+        client_frames += target.client->stats().frames_written.load();
+        target.client.reset();
+        total.merge(target.stats->histogram);
+        completed += target.stats->completed.load();
+        errors += target.stats->errors.load();
+    }
+    if (client_io) {
+        client_io->stop();
+        client_io_thread.join();
+    }
+    double server_frames_per_write = 0;
+    double server_frames_per_read = 0;
+    uint64_t server_expired = 0;
+    uint64_t server_migrations = 0;
+    uint64_t server_saved = 0;
+    uint64_t server_compress_cpu_ns = 0;
+    if (server) {
+        IoStats stats = server->stats();
+        server_expired = stats.expired.load();
+        server_saved = stats.bytes_saved();
+        server_compress_cpu_ns = stats.compress_cpu_ns.load() + stats.decompress_cpu_ns.load();
+        server_migrations = stats.migrations.load();
+        server_frames_per_write = stats.frames_per_write();
+        server_frames_per_read = stats.frames_per_read();
+        for (auto& pool : server->worker_pool_stats()) {
+            std::printf("worker pool %s: threads %zu, queue depth %zu, executed %llu, "
+                        "rejected %llu\n",
+                        pool.name.c_str(), pool.threads, pool.queue_depth,
+                        static_cast<unsigned long long>(pool.executed),
+                        static_cast<unsigned long long>(pool.rejected));
+        }
+        server->stop();
+        server_thread.join();
+    }
+
+    double elapsed = std::chrono::duration<double>(end - start).count();
+    double send_elapsed = std::chrono::duration<double>(send_end - start).count();
+    std::printf("sent: %llu (%.0f req/s), completed: %llu, errors: %llu, dropped: %llu, "
+                "lost: %llu\n",
+                static_cast<unsigned long long>(sent.load()), sent.load() / send_elapsed,
+                static_cast<unsigned long long>(completed), static_cast<unsigned long long>(errors),
+                static_cast<unsigned long long>(dropped.load()),
+                static_cast<unsigned long long>(lost));
+    std::printf("achieved: %.0f req/s\n", completed / elapsed);
+    std::printf("deadline exceeded: client %llu, server skipped %llu\n",
+                static_cast<unsigned long long>(client_expired),
+                static_cast<unsigned long long>(server_expired));
+    std::printf("frames per write: client %.2f, server %.2f; server frames per read: %.2f\n",
+                client_batches == 0 ? 0.0 : static_cast<double>(client_frames) / client_batches,
+                server_frames_per_write, server_frames_per_read);
+    std::printf("server connection migrations: %llu\n",
+                static_cast<unsigned long long>(server_migrations));
+    if (opt.compress > 0) {
+        std::printf("compression: client saved %llu bytes in %.1f ms, "
+                    "server saved %llu bytes in %.1f ms (compress + decompress CPU time)\n",
+                    static_cast<unsigned long long>(client_saved), client_compress_cpu_ns / 1e6,
+                    static_cast<unsigned long long>(server_saved), server_compress_cpu_ns / 1e6);
+    }
+    std::printf("latency (us, from intended send time):\n");
+    std::printf("  %-8s %10.1f\n", "min", to_us(total.min()));
+    for (double p : {50.0, 90.0, 99.0, 99.9, 99.99}) {
+        std::string label = "p" + std::to_string(p);
+        label.erase(label.find_last_not_of("0") + 1);
+        label.erase(label.find_last_not_of(".") + 1);
+        std::printf("  %-8s %10.1f\n", label.c_str(), to_us(total.percentile(p)));
+    }
+    std::printf("  %-8s %10.1f\n", "max", to_us(total.max()));
+    return lost == 0 && errors == 0 ? 0 : 2;
+}
@@ -0,0 +1,632 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "bench_util.hpp"
+#include "trpc/codec.hpp"
+#include "trpc/func_id.hpp"
+#include "trpc/lz4.hpp"
+#include "trpc/md5.hpp"
+#include "trpc/message.h"
+#include "trpc/pending_table.hpp"
+#include "trpc/read_buffer.hpp"
+#include "trpc/router.hpp"
+#include "trpc/rpc_client.hpp"
+#include "trpc/rpc_result.hpp"
+
+namespace trpc {
+namespace bench {
+Counters& counters() {
+    static Counters c;
+    return c;
+}
+} // namespace bench
+} // namespace trpc
+
+// 统计堆分配次数与字节数: operator new 与 msgpack::sbuffer 最终都走 malloc/realloc,
+// 这里直接替换并转发给 glibc 的实现
+extern "C" {
+void* __libc_malloc(size_t);
+void* __libc_calloc(size_t, size_t);
+void* __libc_realloc(void*, size_t);
+
+void* malloc(size_t size) {
+    auto& c = trpc::bench::counters();
+    c.allocs.fetch_add(1, std::memory_order_relaxed);
+    c.alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+    auto& c = trpc::bench::counters();
+    c.allocs.fetch_add(1, std::memory_order_relaxed);
+    c.alloc_bytes.fetch_add(n * size, std::memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* p, size_t size) {
+    auto& c = trpc::bench::counters();
+    c.allocs.fetch_add(1, std::memory_order_relaxed);
+    c.alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+    return __libc_realloc(p, size);
+}
+}
+
+// 统计经过 memcpy 的字节数 (std::string 拷贝、sbuffer::write 等都走这里);
+// 转发给 memmove 以避免递归
+extern "C" void* memcpy(void* dst, const void* src, size_t n) {
+    trpc::bench::counters().copied_bytes.fetch_add(n, std::memory_order_relaxed);
+    return std::memmove(dst, src, n);
+}
+
+using namespace trpc;
+
+namespace {
+struct Item {
+    int id;
+    std::string name;
+    double score;
+
+    MSGPACK_DEFINE(id, name, score);
+};
+
+// 把 (args...) 编码进新的 buffer, 用于准备基准的输入
+template <typename... Args>
+msgpack_codec::buffer_type packed(Args&&... args) {
+    msgpack_codec::buffer_type buffer;
+    msgpack_codec::pack_args_to(buffer, std::forward<Args>(args)...);
+    return buffer;
+}
+
+template <typename... Args>
+std::string packed_str(Args&&... args) {
+    auto buffer = packed(std::forward<Args>(args)...);
+    return std::string(buffer.data(), buffer.size());
+}
+
+void bench_codec() {
+    std::string payload_1k(1024, 'x');
+    std::string payload_64k(64 * 1024, 'x');
+
+    // 编码进复用的 buffer, 同 Connection / RpcClient 编码帧的方式
+    msgpack_codec::buffer_type out;
+    bench::run("codec/pack_args_to(buffer,int,int)", [&] {
+        out.clear();
+        msgpack_codec::pack_args_to(out, 1, 2);
+        bench::do_not_optimize(out.data());
+    });
+    bench::run("codec/pack_args_to(buffer,string 1KB)", [&] {
+        out.clear();
+        msgpack_codec::pack_args_to(out, payload_1k);
+        bench::do_not_optimize(out.data());
+    });
+    bench::run("codec/pack_args_to(buffer,string 64KB)", [&] {
+        out.clear();
+        msgpack_codec::pack_args_to(out, payload_64k);
+        bench::do_not_optimize(out.data());
+    });
+    bench::run("codec/pack_args_to(buffer,struct)", [&] {
+        out.clear();
+        msgpack_codec::pack_args_to(out, Item{1, "item-name", 0.5});
+        bench::do_not_optimize(out.data());
+    });
+    bench::run("codec/pack_args_to(buffer,OK,int)", [&] {
+        out.clear();
+        msgpack_codec::pack_args_to(out, FuncResultCode::OK, 42);
+        bench::do_not_optimize(out.data());
+    });
+    bench::run("codec/packed_size(int,int)", [] {
+        bench::do_not_optimize(msgpack_codec::packed_size(1, 2));
+    });
+
+    auto ints = packed(1, 2);
+    bench::run("codec/unpack<tuple<int,int>>", [&] {
+        msgpack::object_handle handle;
+        auto tp = msgpack_codec::unpack<std::tuple<int, int>>(handle, ints.data(), ints.size());
+        bench::do_not_optimize(tp);
+    });
+    auto str_1k = packed(payload_1k);
+    bench::run("codec/unpack<tuple<string>> 1KB", [&] {
+        msgpack::object_handle handle;
+        auto tp =
+            msgpack_codec::unpack<std::tuple<std::string>>(handle, str_1k.data(), str_1k.size());
+        bench::do_not_optimize(std::get<0>(tp).data());
+    });
+    auto item = packed(Item{1, "item-name", 0.5});
+    bench::run("codec/unpack<tuple<struct>>", [&] {
+        msgpack::object_handle handle;
+        auto tp = msgpack_codec::unpack<std::tuple<Item>>(handle, item.data(), item.size());
+        bench::do_not_optimize(std::get<0>(tp).id);
+    });
+    // 复用 zone 且引用原缓冲区
+    msgpack::zone zone;
+    bench::run("codec/unpack<tuple<string_view>> 1KB zone", [&] {
+        auto tp =
+            msgpack_codec::unpack<std::tuple<std::string_view>>(zone, str_1k.data(), str_1k.size());
+        bench::do_not_optimize(std::get<0>(tp).data());
+        zone.clear();
+    });
+}
+
+// handler 参数为 std::string 与 std::string_view 时, 大参数的分发开销
+void bench_blob_args() {
+    Router router;
+    router.register_handler("blob_copy", [](const std::string& data) { return data.size(); });
+    router.register_handler("blob_view", [](std::string_view data) { return data.size(); });
+    router.freeze();
+    msgpack_codec::buffer_type out(msgpack_codec::init_size);
+    for (size_t size : {4 * 1024, 1024 * 1024}) {
+        auto args = packed(std::string(size, 'x'));
+        std::string_view view(args.data(), args.size());
+        for (const char* name : {"blob_copy", "blob_view"}) {
+            uint32_t key = func_id(name).value;
+            std::string label = std::string("router/") + name + " " + std::to_string(size / 1024);
+            bench::run(label + "KB", [&] {
+                out.clear();
+                router.route(key, view, out);
+                bench::do_not_optimize(out.data());
+            });
+        }
+    }
+}
+
+// 数值数组: std::vector<float> 逐个元素编码与 TypedArray/ArrayView 整体编码对比,
+// 吞吐量按数组本身的字节数计算
+void bench_typed_array() {
+    auto report = [](const bench::Result& r, size_t bytes) {
+        std::printf("%-44s %12.2f GB/s\n", ("  " + r.name).c_str(),
+                    static_cast<double>(bytes) / r.ns_per_op);
+    };
+    msgpack::zone zone;
+    for (size_t n : {1000, 100 * 1000, 1000 * 1000, 10 * 1000 * 1000}) {
+        std::vector<float> values(n);
+        for (size_t i = 0; i < n; ++i) {
+            values[i] = static_cast<float>(i) * 0.5f;
+        }
+        size_t bytes = n * sizeof(float);
+        std::string suffix = " " + std::to_string(n);
+        msgpack_codec::buffer_type elementwise(bytes * 5 + 64);
+        msgpack_codec::buffer_type typed(bytes + 64);
+        auto r = bench::run("array/pack elementwise" + suffix, [&] {
+            elementwise.clear();
+            msgpack_codec::pack_args_to(elementwise, values);
+            bench::do_not_optimize(elementwise.data());
+        });
+        report(r, bytes);
+        r = bench::run("array/pack typed" + suffix, [&] {
+            typed.clear();
+            msgpack_codec::pack_args_to(typed, ArrayView<float>(values));
+            bench::do_not_optimize(typed.data());
+        });
+        report(r, bytes);
+        r = bench::run("array/unpack elementwise -> vector" + suffix, [&] {
+            auto t = msgpack_codec::unpack<std::tuple<std::vector<float>>>(
+                zone, elementwise.data(), elementwise.size());
+            bench::do_not_optimize(std::get<0>(t).data());
+            zone.clear();
+        });
+        report(r, bytes);
+        r = bench::run("array/unpack typed -> TypedArray" + suffix, [&] {
+            auto t = msgpack_codec::unpack<std::tuple<TypedArray<float>>>(zone, typed.data(),
+                                                                          typed.size());
+            bench::do_not_optimize(std::get<0>(t).data());
+            zone.clear();
+        });
+        report(r, bytes);
+        // 不拷贝元素, 耗时与数组长度无关
+        bench::run("array/unpack typed -> ArrayView" + suffix, [&] {
+            auto t = msgpack_codec::unpack<std::tuple<ArrayView<float>>>(zone, typed.data(),
+                                                                         typed.size());
+            bench::do_not_optimize(std::get<0>(t).size());
+            zone.clear();
+        });
+    }
+}
+
+// LZ4 压缩/解压吞吐: 重复度较高的文本 (类似 JSON 日志) 与随机数据 (不可压缩, 测试跳过的速度)
+void bench_compression() {
+    auto report = [](const bench::Result& r, size_t bytes) {
+        std::printf("%-44s %12.2f GB/s\n", ("  " + r.name).c_str(),
+                    static_cast<double>(bytes) / r.ns_per_op);
+    };
+    std::mt19937 rng(42);
+    for (size_t n : {4 * 1024, 64 * 1024, 1024 * 1024}) {
+        std::string text;
+        while (text.size() < n) {
+            text += "{\"id\":" + std::to_string(rng() % 100000) + ",\"status\":\"ok\",\"value\":" +
+                    std::to_string(rng() % 1000) + "},";
+        }
+        text.resize(n);
+        std::string noise(n, '\0');
+        for (auto& c : noise) {
+            c = static_cast<char>(rng());
+        }
+        std::string suffix = " " + std::to_string(n / 1024) + "K";
+        std::vector<char> compressed(n);
+        std::string restored(n, '\0');
+        for (const std::string* input : {&text, &noise}) {
+            std::string name = input == &text ? "text" : "random";
+            size_t len = 0;
+            auto r = bench::run("lz4/compress " + name + suffix, [&] {
+                len = lz4::compress(input->data(), n, compressed.data(), compressed.size());
+                bench::do_not_optimize(len);
+            });
+            report(r, n);
+            if (len == 0) {
+                continue; // 不可压缩, 照原样发送
+            }
+            std::printf("%-44s %12.2f\n", ("  lz4/ratio " + name + suffix).c_str(),
+                        static_cast<double>(n) / static_cast<double>(len));
+            r = bench::run("lz4/decompress " + name + suffix, [&] {
+                bool ok = lz4::decompress(compressed.data(), len, restored.data(), n);
+                bench::do_not_optimize(ok);
+            });
+            report(r, n);
+        }
+    }
+}
+
+// LZ4 正确性检查, 在计时之前运行: 随机、重复与文本数据压缩后必须原样解压;
+// 截断或长度不符的输入必须返回 false, 篡改的输入和随机字节不能写出目标缓冲区。
+// 目标缓冲区后面放保护字节检查越界写; 用 -fsanitize=address 编译可同时检查越界读
+bool check_lz4() {
+    constexpr size_t GUARD = 64;
+    constexpr char GUARD_BYTE = 0x5a;
+    size_t failures = 0;
+    auto fail = [&](const std::string& what, size_t n) {
+        std::fprintf(stderr, "lz4 check failed: %s (%zu bytes)\n", what.c_str(), n);
+        ++failures;
+    };
+    // 输入拷贝到恰好大小的堆内存中, 越界读能被 sanitizer 发现
+    auto decode = [&](const std::string& src, size_t out_len, std::string* out) {
+        std::vector<char> in(src.begin(), src.end());
+        std::vector<char> dst(out_len + GUARD, GUARD_BYTE);
+        bool ok = lz4::decompress(in.data(), in.size(), dst.data(), out_len);
+        auto overwritten = [&](char c) { return c != GUARD_BYTE; };
+        if (std::any_of(dst.begin() + out_len, dst.end(), overwritten)) {
+            fail("write past the output buffer", out_len);
+        }
+        if (out != nullptr) {
+            out->assign(dst.data(), out_len);
+        }
+        return ok;
+    };
+
+    std::mt19937 rng(7);
+    std::vector<std::string> inputs;
+    for (size_t n : {0, 1, 5, 12, 13, 16, 17, 64, 100, 4096, 65536 + 123, 1024 * 1024}) {
+        std::string random(n, '\0');
+        for (auto& c : random) {
+            c = static_cast<char>(rng());
+        }
+        std::string pattern(n, '\0');
+        for (size_t i = 0; i < n; ++i) {
+            pattern[i] = "abcdefg"[i % 7]; // 偏移小于匹配长度的重叠复制
+        }
+        std::string text;
+        while (text.size() < n) {
+            text += "{\"id\":" + std::to_string(rng() % 100000) + ",\"status\":\"ok\"},";
+        }
+        text.resize(n);
+        inputs.push_back(std::move(random));
+        inputs.push_back(std::string(n, 'a'));
+        inputs.push_back(std::move(pattern));
+        inputs.push_back(std::move(text));
+    }
+    for (const auto& input : inputs) {
+        size_t n = input.size();
+        std::string compressed(n + n / 255 + 16, '\0'); // 不可压缩数据的最大长度
+        size_t len = lz4::compress(input.data(), n, compressed.data(), compressed.size());
+        if (len == 0) {
+            fail("compress", n);
+            continue;
+        }
+        compressed.resize(len);
+        std::string restored;
+        if (!decode(compressed, n, &restored) || restored != input) {
+            fail("round trip", n);
+        }
+        if (decode(compressed, n + 1, nullptr) || (n > 0 && decode(compressed, n - 1, nullptr))) {
+            fail("wrong output length accepted", n);
+        }
+        size_t step = std::max<size_t>(1, len / 256);
+        for (size_t cut = 0; n > 0 && cut < len; cut += step) { // 空输入的空前缀本身合法
+            if (decode(compressed.substr(0, cut), n, nullptr)) {
+                fail("truncated input accepted", n);
+                break;
+            }
+        }
+        for (int i = 0; i < 256; ++i) { // 篡改的输入可能碰巧合法, 只要求不越界
+            std::string corrupt = compressed;
+            corrupt[rng() % len] = static_cast<char>(rng());
+            decode(corrupt, n, nullptr);
+        }
+    }
+    for (int i = 0; i < 4096; ++i) {
+        std::string garbage(1 + rng() % 256, '\0');
+        for (auto& c : garbage) {
+            c = static_cast<char>(rng());
+        }
+        decode(garbage, rng() % 4096, nullptr);
+    }
+    std::printf("%-44s %12s\n", "lz4/check round trip + corrupt input",
+                failures == 0 ? "ok" : "FAILED");
+    return failures == 0;
+}
+
+struct Tick {
+    int64_t id;
+    double bid;
+    double ask;
+    int32_t bid_size;
+    int32_t ask_size;
+    int64_t timestamp;
+
+    using raw_fields = std::tuple<int64_t, double, double, int32_t, int32_t, int64_t>;
+    MSGPACK_DEFINE(id, bid, ask, bid_size, ask_size, timestamp);
+};
+
+// 可平凡拷贝的参数与结果: 客户端编码参数 + 服务端分发 + 客户端解码结果, msgpack 与 RawCodec 对比
+template <typename Codec>
+void bench_codec_roundtrip(const char* label) {
+    Router router;
+    router.register_handler("update", [](Tick tick, double spread) {
+        tick.ask = tick.bid + spread;
+        return tick;
+    });
+    router.freeze();
+    uint32_t key = func_id("update").value;
+    Tick tick{42, 1.5, 1.75, 100, 200, 1700000000};
+    msgpack_codec::buffer_type args(msgpack_codec::init_size);
+    msgpack_codec::buffer_type out(msgpack_codec::init_size);
+    bench::run(std::string("codec/") + label + " roundtrip(Tick, double)", [&] {
+        args.clear();
+        Codec::pack_args(args, tick, 0.25);
+        out.clear();
+        CodecType codec = router.route(key, std::string_view(args.data(), args.size()), out,
+                                       Codec::TYPE);
+        RpcResult result(std::string_view(out.data(), out.size()), codec);
+        bench::do_not_optimize(result.as<Tick>().ask);
+    });
+}
+
+void bench_router(size_t handlers) {
+    Router router;
+    std::vector<uint32_t> keys;
+    keys.reserve(handlers);
+    for (size_t i = 0; i < handlers; ++i) {
+        std::string name = "service.method_" + std::to_string(i);
+        router.register_handler(name, [](int a, int b) { return a + b; });
+        keys.push_back(func_id(name).value);
+    }
+    // 随机访问顺序，避免始终命中同一个桶
+    std::vector<uint32_t> order(1024);
+    std::mt19937 rng(42);
+    for (auto& k : order) {
+        k = keys[rng() % keys.size()];
+    }
+    auto args = packed(1, 2);
+    std::string_view view(args.data(), args.size());
+    size_t i = 0;
+    msgpack_codec::buffer_type out(msgpack_codec::init_size);
+    for (bool frozen : {false, true}) {
+        if (frozen) {
+            router.freeze();
+        }
+        std::string suffix =
+            " " + std::to_string(handlers) + " handlers" + (frozen ? " frozen" : "");
+        bench::run("router/route(int,int)" + suffix, [&] {
+            out.clear();
+            router.route(order[i++ & 1023], view, out);
+            bench::do_not_optimize(out.data());
+        });
+        bench::run("router/route unknown" + suffix, [&] {
+            out.clear();
+            router.route(0xdeadbeef, view, out);
+            bench::do_not_optimize(out.data());
+        });
+        bench::run("router/find" + suffix, [&] {
+            auto handler = router.find(order[i++ & 1023]);
+            bench::do_not_optimize(handler);
+        });
+    }
+}
+
+void bench_md5() {
+    for (size_t len : {4, 16, 32, 64, 128}) {
+        std::string name(len, 'a');
+        bench::run("md5/MD5Hash32 " + std::to_string(len) + "B name", [&] {
+            auto id = MD5::MD5Hash32(name.data());
+            bench::do_not_optimize(id);
+        });
+    }
+    // 调用方传入函数名时, 每次调用都要构造 FuncId (计算哈希); 预先算好的 id 只是一次拷贝
+    std::string name = "service.method";
+    bench::run("md5/FuncId from std::string", [&] {
+        FuncId id(name);
+        bench::do_not_optimize(id.value);
+    });
+    static constexpr FuncId PRECOMPUTED = func_id("service.method");
+    bench::run("md5/FuncId precomputed", [&] {
+        FuncId id = PRECOMPUTED;
+        bench::do_not_optimize(id.value);
+    });
+}
+
+void bench_result() {
+    auto int_result = packed_str(FuncResultCode::OK, 42);
+    bench::run("result/RpcResult::as<int>", [&] {
+        RpcResult result(int_result);
+        bench::do_not_optimize(result.as<int>());
+    });
+    auto str_result = packed_str(FuncResultCode::OK, std::string(1024, 'x'));
+    bench::run("result/RpcResult::as<string> 1KB", [&] {
+        RpcResult result(str_result);
+        auto s = result.as<std::string>();
+        bench::do_not_optimize(s.data());
+    });
+    auto struct_result = packed_str(FuncResultCode::OK, Item{1, "name", 0.5});
+    bench::run("result/RpcResult::as<struct>", [&] {
+        RpcResult result(struct_result);
+        bench::do_not_optimize(result.as<Item>().id);
+    });
+    bench::run("result/RpcResult::try_as<int>", [&] {
+        RpcResult result(int_result);
+        int value = 0;
+        bench::do_not_optimize(result.try_as(value).ok());
+        bench::do_not_optimize(value);
+    });
+    bench::run("result/RpcResult::as<string_view> 1KB", [&] {
+        RpcResult result(str_result);
+        bench::do_not_optimize(result.as<std::string_view>().data());
+    });
+    auto fail_result = packed_str(FuncResultCode::FAIL, "unknown function");
+    bench::run("result/RpcResult::status() FAIL", [&] {
+        RpcResult result(fail_result);
+        bench::do_not_optimize(result.status().message.data());
+    });
+    // 大结果: 拷贝响应体 vs 接管读缓冲区 (客户端对独占扩容缓冲区的大帧的处理)
+    auto big_result = packed_str(FuncResultCode::OK, std::string(1 << 20, 'x'));
+    bench::run("result/1MB copy + as<string_view>", [&] {
+        RpcResult result(big_result);
+        bench::do_not_optimize(result.as<std::string_view>().size());
+    });
+    // 模拟客户端分多次读入一个 1MB 的响应帧, 比较拷贝响应体与接管读缓冲区
+    RpcHeader header{};
+    header.body_len = static_cast<uint32_t>(big_result.size());
+    std::string frame(reinterpret_cast<const char*>(&header), RPC_HEAD_LEN);
+    frame += big_result;
+    ReadBuffer read_buffer(64 * 1024);
+    auto read_frame = [&] {
+        for (size_t off = 0; off < frame.size();) {
+            read_buffer.reserve_for_next();
+            auto space = read_buffer.prepare();
+            size_t len = std::min(space.size(), frame.size() - off);
+            std::memcpy(space.data(), frame.data() + off, len);
+            read_buffer.commit(len);
+            off += len;
+        }
+        std::string_view body;
+        read_buffer.next_frame(header, body);
+        return body;
+    };
+    bench::run("result/read 1MB frame + copy", [&] {
+        RpcResult result(read_frame());
+        bench::do_not_optimize(result.status().ok());
+    });
+    bench::run("result/read 1MB frame + handover", [&] {
+        std::string_view body = read_frame();
+        Buffer storage;
+        if (read_buffer.release_frame(body, storage)) {
+            RpcResult result(std::move(storage), body);
+            bench::do_not_optimize(result.status().ok());
+        }
+    });
+}
+
+void bench_frame() {
+    // 客户端请求成帧: 从回收池取缓冲区，帧头之后直接编码参数 (同 RpcClient)
+    BufferPool pool(16, MAX_RETAINED_BUFFER_SIZE);
+    std::string name = "service.method";
+    bench::run("frame/request(int,int)", [&] {
+        auto buffer = pool.acquire();
+        if (buffer.capacity() == 0) {
+            buffer.reserve(RPC_HEAD_LEN + msgpack_codec::packed_size(1, 2));
+        }
+        buffer.resize(RPC_HEAD_LEN);
+        msgpack_codec::pack_args_to(buffer, 1, 2);
+        RpcHeader header{1, static_cast<uint32_t>(buffer.size() - RPC_HEAD_LEN),
+                         MD5::MD5Hash32(name.data())};
+        std::memcpy(buffer.data(), &header, RPC_HEAD_LEN);
+        bench::do_not_optimize(buffer.data());
+        pool.release(std::move(buffer));
+    });
+    // 服务端响应成帧: 预留帧头后将 route 结果直接编码进复用的缓冲区 (同 Connection)
+    Router router;
+    router.register_handler("echo", [](const std::string& s) { return s; });
+    uint32_t key = MD5::MD5Hash32("echo");
+    for (size_t len : {16, 1024, 64 * 1024, 4 * 1024 * 1024}) {
+        auto args = packed(std::string(len, 'x'));
+        msgpack_codec::buffer_type frame(msgpack_codec::init_size);
+        bench::run("frame/response(echo " + std::to_string(len) + "B)", [&] {
+            frame.clear();
+            frame.resize(RPC_HEAD_LEN);
+            router.route(key, std::string_view(args.data(), args.size()), frame);
+            RpcHeader header{1, static_cast<uint32_t>(frame.size() - RPC_HEAD_LEN), key};
+            std::memcpy(frame.data(), &header, RPC_HEAD_LEN);
+            bench::do_not_optimize(frame.data());
+        });
+    }
+}
+void bench_pending() {
+    // 请求注册 + 响应完成, 保存的是 RpcClient 实际使用的 PendingCall:
+    // 旧实现的 mutex + unordered_map 与无锁槽位表对比。future 版本每次调用分配 promise 的共享状态
+    std::unordered_map<uint64_t, PendingCall> map;
+    std::mutex mutex;
+    uint64_t next_id = 0;
+    bench::run("pending/mutex+unordered_map", [&] {
+        PendingCall pending;
+        auto future = pending.promise.emplace().get_future();
+        uint64_t id;
+        {
+            std::lock_guard lock(mutex);
+            id = next_id++;
+            map.emplace(id, std::move(pending));
+        }
+        {
+            std::lock_guard lock(mutex);
+            auto it = map.find(id);
+            pending = std::move(it->second);
+            map.erase(it);
+        }
+        pending.promise->set_value(RpcResult::error("done"));
+        bench::do_not_optimize(future);
+    });
+    PendingTable<PendingCall> table(DEFAULT_MAX_PENDING_CALLS);
+    bench::run("pending/PendingTable future", [&] {
+        PendingCall pending;
+        auto future = pending.promise.emplace().get_future();
+        uint64_t id;
+        table.insert(pending, id);
+        table.take(id, pending);
+        pending.promise->set_value(RpcResult::error("done"));
+        bench::do_not_optimize(future);
+    });
+    bench::run("pending/PendingTable callback", [&] {
+        PendingCall pending;
+        pending.callback = [](RpcResult) {};
+        uint64_t id;
+        table.insert(pending, id);
+        table.take(id, pending);
+        pending.callback(RpcResult::error("done"));
+        bench::do_not_optimize(pending);
+    });
+}
+} // namespace
+
+int main() {
+    if (!check_lz4()) {
+        return 1;
+    }
+    bench::print_header();
+    bench_codec();
+    for (size_t n : {10, 1000, 10000}) {
+        bench_router(n);
+    }
+    bench_blob_args();
+    bench_typed_array();
+    bench_compression();
+    bench_codec_roundtrip<MsgpackCodec>("msgpack");
+    bench_codec_roundtrip<RawCodec>("raw");
+    bench_md5();
+    bench_result();
+    bench_frame();
+    bench_pending();
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace trpc {
+// 每个回收池最多保留的缓冲区总容量，避免偶发的大包长期占用内存
+static constexpr size_t MAX_RETAINED_BUFFER_SIZE = 8 * 1024 * 1024;
+
+// 可复用的输出缓冲区，满足 msgpack::packer 对 Stream 的要求 (write(const char*, size_t))。
+// 与 msgpack::sbuffer 不同，它可以截断 (resize) 并查询容量，便于在帧头之后直接编码并重复使用。
+class Buffer {
+public:
+    explicit Buffer(size_t capacity = 0) { reserve(capacity); }
+
+    Buffer(Buffer&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)),
+          size_(std::exchange(other.size_, 0)),
+          capacity_(std::exchange(other.capacity_, 0)) {}
+
+    Buffer& operator=(Buffer&& other) noexcept {
+        if (this != &other) {
+            std::free(data_);
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            capacity_ = std::exchange(other.capacity_, 0);
+        }
+        return *this;
+    }
+
+    Buffer(const Buffer&) = delete;
+    Buffer& operator=(const Buffer&) = delete;
+
+    ~Buffer() { std::free(data_); }
+
+    void write(const char* buf, size_t len) {
+        if (capacity_ - size_ < len) {
+            grow(size_ + len);
+        }
+        std::memcpy(data_ + size_, buf, len);
+        size_ += len;
+    }
+
+    char* data() { return data_; }
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    size_t capacity() const { return capacity_; }
+    bool empty() const { return size_ == 0; }
+
+    void clear() { size_ = 0; }
+
+    // 扩大时新增部分不做初始化
+    void resize(size_t size) {
+        if (size > capacity_) {
+            grow(size);
+        }
+        size_ = size;
+    }
+
+    void reserve(size_t capacity) {
+        if (capacity > capacity_) {
+            realloc_to(capacity);
+        }
+    }
+
+private:
+    void grow(size_t min_capacity) {
+        size_t capacity = capacity_ == 0 ? 64 : capacity_ * 2;
+        while (capacity < min_capacity) {
+            capacity *= 2;
+        }
+        realloc_to(capacity);
+    }
+
+    void realloc_to(size_t capacity) {
+        void* p = std::realloc(data_, capacity);
+        if (p == nullptr) {
+            throw std::bad_alloc();
+        }
+        data_ = static_cast<char*>(p);
+        capacity_ = capacity;
+    }
+
+    char* data_{nullptr};
+    size_t size_{0};
+    size_t capacity_{0};
+};
+
+// 已发送缓冲区的回收池，非线程安全 (由使用者加锁或保证单线程访问)。
+// 最多保留 max_buffers 个缓冲区，且总容量不超过 max_retained_size。
+class BufferPool {
+public:
+    BufferPool(size_t max_buffers, size_t max_retained_size)
+        : max_buffers_(max_buffers),
+          max_retained_size_(max_retained_size) {}
+
+    // 池为空时返回容量为 initial_capacity 的新缓冲区
+    Buffer acquire(size_t initial_capacity = 0) {
+        if (buffers_.empty()) {
+            return Buffer(initial_capacity);
+        }
+        Buffer buffer = std::move(buffers_.back());
+        buffers_.pop_back();
+        retained_size_ -= buffer.capacity();
+        return buffer;
+    }
+
+    void release(Buffer buffer) {
+        if (buffers_.size() >= max_buffers_ ||
+            retained_size_ + buffer.capacity() > max_retained_size_) {
+            return;
+        }
+        buffer.clear();
+        retained_size_ += buffer.capacity();
+        buffers_.emplace_back(std::move(buffer));
+    }
+
+private:
+    std::vector<Buffer> buffers_;
+    size_t retained_size_{0};
+    size_t max_buffers_;
+    size_t max_retained_size_;
+};
+} // namespace trpc
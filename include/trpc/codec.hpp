@@ -1,30 +1,53 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
 #include <type_traits>
 
 #include "msgpack.hpp"
+#include "trpc/buffer.hpp"
+#include "trpc/message.h"
+#include "trpc/meta_util.hpp"
+#include "trpc/typed_array.hpp"
 
 namespace trpc {
 namespace msgpack_codec {
 
-using buffer_type = msgpack::sbuffer;
+using buffer_type = Buffer;
 constexpr size_t init_size = 2 * 1024;
 
+// 枚举 (如 FuncResultCode) 按 int 编码，其余参数原样转发
+template <typename T>
+decltype(auto) packable(T&& t) {
+    if constexpr (std::is_enum_v<std::decay_t<T>>) {
+        return static_cast<int>(t);
+    } else {
+        return std::forward<T>(t);
+    }
+}
+
+// 将 (args...) 追加编码到已有 buffer 的末尾，不产生中间拷贝
 template <typename... Args>
-buffer_type pack_args(Args&&... args) {
-    buffer_type buffer(init_size);
-    // or make_tuple ?
-    msgpack::pack(buffer, std::forward_as_tuple(std::forward<Args>(args)...));
-    return buffer;
+void pack_args_to(buffer_type& buffer, Args&&... args) {
+    msgpack::pack(buffer, std::forward_as_tuple(packable(std::forward<Args>(args))...));
 }
 
-template <typename Arg, typename... Args, typename = std::enable_if_t<std::is_enum_v<Arg>>>
-std::string pack_args_to_str(Arg arg, Args&&... args) {
-    buffer_type buffer(init_size);
-    msgpack::pack(buffer,
-                  std::forward_as_tuple(static_cast<int>(arg), std::forward<Args>(args)...));
-    /// TODO: avoid copy
-    return std::string(buffer.data(), buffer.size());
+// 只计数不写入的 Stream, 用于预先计算编码长度
+struct size_counter {
+    size_t size = 0;
+    void write(const char*, size_t len) { size += len; }
+};
+
+template <typename... Args>
+size_t packed_size(const Args&... args) {
+    size_counter counter;
+    msgpack::pack(counter, std::forward_as_tuple(packable(args)...));
+    return counter.size;
 }
 
 template <typename T>
@@ -45,5 +68,289 @@ T unpack(msgpack::object_handle& obj_handle, const char* data, size_t length) {
     }
 }
 
+// 解码时 STR/BIN/EXT 直接引用原缓冲区中的字节, 不拷贝到 zone
+inline bool reference_all(msgpack::type::object_type, std::size_t, void*) { return true; }
+
+// 解码到调用者提供的 zone 中, zone 可以在 clear() 后重复使用。
+// std::string_view (C++20 还有 std::span<const char>) 类型的结果直接指向 data, 不发生拷贝
+template <typename T>
+T unpack(msgpack::zone& zone, const char* data, size_t length) {
+    try {
+        msgpack::object obj = msgpack::unpack(zone, data, length, reference_all);
+        return obj.as<T>();
+    } catch (...) {
+        throw std::invalid_argument("unpack failed: Args not match!");
+    }
+}
+
 } // namespace msgpack_codec
-} // namespace trpc
\ No newline at end of file
+
+// 编解码方式 (codec trait), 客户端按调用选择, 写入帧头 flags; 服务端据此选择 handler 的解码方式:
+//   TYPE                            帧头中的 CodecType
+//   accepts<T>                      能否编码参数或结果类型 T (编译期)
+//   args_size(args...)              参数编码后的长度
+//   pack_args(out, args...)         追加编码请求参数
+//   unpack_args<Tuple>(zone, data)  解码请求参数, 不匹配时抛出 std::invalid_argument
+//   pack_ok(out[, value]), pack_fail(out, message)  追加编码结果
+struct MsgpackCodec {
+    static constexpr CodecType TYPE = CodecType::MSGPACK;
+
+    template <typename T>
+    static constexpr bool accepts = true;
+
+    template <typename... Args>
+    static size_t args_size(const Args&... args) {
+        return msgpack_codec::packed_size(args...);
+    }
+
+    template <typename... Args>
+    static void pack_args(Buffer& out, Args&&... args) {
+        msgpack_codec::pack_args_to(out, std::forward<Args>(args)...);
+    }
+
+    template <typename Tuple>
+    static Tuple unpack_args(msgpack::zone& zone, std::string_view data) {
+        return msgpack_codec::unpack<Tuple>(zone, data.data(), data.size());
+    }
+
+    static void pack_ok(Buffer& out) { msgpack_codec::pack_args_to(out, FuncResultCode::OK); }
+
+    template <typename T>
+    static void pack_ok(Buffer& out, const T& value) {
+        msgpack_codec::pack_args_to(out, FuncResultCode::OK, value);
+    }
+
+    static void pack_fail(Buffer& out, std::string_view message) {
+        msgpack_codec::pack_args_to(out, FuncResultCode::FAIL, message);
+    }
+};
+
+// RawCodec 编码的类类型须按声明顺序列出字段类型, 字段逐个参与签名, 大小相同而字段不同的类型
+// 因此不会被当成同一种类型: 在类中声明 using raw_fields = std::tuple<字段类型...>; 或特化 RawFields<T>。
+// 列出的字段须恰好得到该类的大小和对齐, 否则视为不可用 RawCodec 编码
+template <typename T, typename = void>
+struct RawFields {};
+
+template <typename T>
+struct RawFields<T, std::void_t<typename T::raw_fields>> {
+    using type = typename T::raw_fields;
+};
+
+namespace detail {
+template <typename T>
+constexpr bool raw_encodable();
+
+// 按声明顺序排列字段, 算出的大小和对齐须与类的实际布局一致
+template <typename T, typename... Fs>
+constexpr bool raw_layout_matches(std::tuple<Fs...>*) {
+    if constexpr ((raw_encodable<Fs>() && ...)) {
+        size_t align = 1;
+        size_t size = 0;
+        ((size = (size + alignof(Fs) - 1) / alignof(Fs) * alignof(Fs) + sizeof(Fs),
+          align = std::max(align, alignof(Fs))),
+         ...);
+        size = (size + align - 1) / align * align;
+        return size == sizeof(T) && align == alignof(T);
+    } else {
+        return false;
+    }
+}
+
+template <typename T, typename Fields = typename RawFields<T>::type>
+constexpr bool raw_fields_match(int) {
+    return raw_layout_matches<T>(static_cast<Fields*>(nullptr));
+}
+
+// 未列出字段的类匹配这个重载
+template <typename T>
+constexpr bool raw_fields_match(...) {
+    return false;
+}
+
+template <typename T>
+constexpr bool raw_encodable() {
+    if constexpr (!std::is_trivially_copyable_v<T> || std::is_pointer_v<T> ||
+                  std::is_member_pointer_v<T> || std::is_union_v<T> || IsBorrowed<T>::value) {
+        return false;
+    } else if constexpr (std::is_array_v<T>) {
+        return raw_encodable<std::remove_extent_t<T>>();
+    } else if constexpr (std::is_class_v<T>) {
+        return raw_fields_match<T>(0);
+    } else {
+        return true;
+    }
+}
+} // namespace detail
+
+// 可平凡拷贝的参数与结果按内存布局直接 memcpy, 省去 msgpack 的编解码。
+// 只能用于字节序和 ABI 相同的两端, 参数类型须与 handler 的参数类型完全一致 (不做类型转换)。
+// 解码时先默认构造再拷贝, 参数与结果类型须可默认构造。
+// 请求: [uint32 签名][参数依次紧密排列]; 成功: [int32 OK][uint32 签名][结果]; 失败: [int32 FAIL][原因]。
+// 签名由各类型 (及类的各字段) 的大小、对齐和种类在编译期算出, 两端不一致时返回 FAIL 而不是读出错误的值
+struct RawCodec {
+    static constexpr CodecType TYPE = CodecType::RAW;
+
+    // 指针和 string_view 等借用类型虽可平凡拷贝, 但其指向的内容不会被发送
+    template <typename T>
+    static constexpr bool accepts = std::is_void_v<T> || detail::raw_encodable<T>();
+
+    template <typename... Ts>
+    static constexpr uint32_t signature() {
+        uint32_t hash = 2166136261u; // FNV-1a
+        mix(hash, sizeof...(Ts));
+        (mix_type<Ts>(hash), ...);
+        return hash;
+    }
+
+    template <typename... Args>
+    static constexpr size_t args_size(const Args&...) {
+        return sizeof(uint32_t) + (sizeof(Args) + ... + 0);
+    }
+
+    template <typename... Args>
+    static void pack_args(Buffer& out, const Args&... args) {
+        static_assert((accepts<Args> && ...),
+                      "RawCodec requires trivially copyable arguments without pointers; "
+                      "class types must list their fields in raw_fields");
+        write(out, signature<Args...>());
+        (write(out, args), ...);
+    }
+
+    template <typename Tuple>
+    static Tuple unpack_args(msgpack::zone&, std::string_view data) {
+        return unpack_tuple(data, static_cast<Tuple*>(nullptr));
+    }
+
+    static void pack_ok(Buffer& out) {
+        write(out, static_cast<int32_t>(FuncResultCode::OK));
+        write(out, signature<>());
+    }
+
+    template <typename T>
+    static void pack_ok(Buffer& out, const T& value) {
+        static_assert(accepts<T>,
+                      "RawCodec requires a trivially copyable result; "
+                      "class types must list their fields in raw_fields");
+        write(out, static_cast<int32_t>(FuncResultCode::OK));
+        write(out, signature<T>());
+        write(out, value);
+    }
+
+    static void pack_fail(Buffer& out, std::string_view message) {
+        write(out, static_cast<int32_t>(FuncResultCode::FAIL));
+        out.write(message.data(), message.size());
+    }
+
+    // 解码结果; value 为 nullptr (或 T 为 void) 时只检查状态
+    template <typename T>
+    static ResultStatus unpack_result(std::string_view body, T* value) {
+        int32_t code;
+        if (body.size() < sizeof(code)) {
+            return {FuncResultCode::FAIL, "bad result format"};
+        }
+        std::memcpy(&code, body.data(), sizeof(code));
+        if (code != static_cast<int32_t>(FuncResultCode::OK)) {
+            return {FuncResultCode::FAIL, body.substr(sizeof(code))};
+        }
+        if constexpr (!std::is_void_v<T>) {
+            if (value != nullptr) {
+                uint32_t sig;
+                if (body.size() != sizeof(code) + sizeof(sig) + sizeof(T)) {
+                    return {FuncResultCode::FAIL, "result type mismatch"};
+                }
+                std::memcpy(&sig, body.data() + sizeof(code), sizeof(sig));
+                if (sig != signature<T>()) {
+                    return {FuncResultCode::FAIL, "result type mismatch"};
+                }
+                std::memcpy(value, body.data() + sizeof(code) + sizeof(sig), sizeof(T));
+            }
+        }
+        return {};
+    }
+
+private:
+    static constexpr void mix(uint32_t& hash, size_t value) {
+        hash = (hash ^ static_cast<uint32_t>(value)) * 16777619u;
+    }
+
+    template <typename T>
+    static constexpr void mix_type(uint32_t& hash) {
+        mix(hash, sizeof(T));
+        mix(hash, alignof(T));
+        mix(hash, kind_of<T>());
+        if constexpr (std::is_enum_v<T>) {
+            mix_type<std::underlying_type_t<T>>(hash);
+        } else if constexpr (std::is_array_v<T>) {
+            mix_type<std::remove_extent_t<T>>(hash);
+        } else if constexpr (std::is_class_v<T>) {
+            mix_fields(hash, static_cast<typename RawFields<T>::type*>(nullptr));
+        }
+    }
+
+    template <typename... Fs>
+    static constexpr void mix_fields(uint32_t& hash, std::tuple<Fs...>*) {
+        mix(hash, sizeof...(Fs));
+        (mix_type<Fs>(hash), ...);
+    }
+
+    template <typename T>
+    static constexpr uint32_t kind_of() {
+        if constexpr (std::is_floating_point_v<T>) {
+            return 1;
+        } else if constexpr (std::is_integral_v<T>) {
+            return std::is_signed_v<T> ? 2 : 3;
+        } else if constexpr (std::is_enum_v<T>) {
+            return 4;
+        } else if constexpr (std::is_array_v<T>) {
+            return 5;
+        } else {
+            return 6;
+        }
+    }
+
+    template <typename T>
+    static void write(Buffer& out, const T& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename... Ts>
+    static std::tuple<Ts...> unpack_tuple(std::string_view data, std::tuple<Ts...>*) {
+        static_assert((accepts<Ts> && ...), "RawCodec requires trivially copyable arguments");
+        static_assert((std::is_default_constructible_v<Ts> && ...),
+                      "RawCodec decodes into default-constructed values, "
+                      "argument types must be default constructible");
+        uint32_t sig = 0;
+        if (data.size() == sizeof(sig) + (sizeof(Ts) + ... + 0)) {
+            std::memcpy(&sig, data.data(), sizeof(sig));
+        }
+        if (sig != signature<Ts...>()) {
+            throw std::invalid_argument("unpack failed: raw arguments not match!");
+        }
+        std::tuple<Ts...> params;
+        const char* p = data.data() + sizeof(sig);
+        std::apply(
+            [&p](Ts&... args) {
+                ((std::memcpy(&args, p, sizeof(Ts)), p += sizeof(Ts)), ...);
+            },
+            params);
+        return params;
+    }
+};
+
+template <typename T>
+struct IsCodec : std::false_type {};
+
+template <>
+struct IsCodec<MsgpackCodec> : std::true_type {};
+
+template <>
+struct IsCodec<RawCodec> : std::true_type {};
+
+// Codec 能否编码 tuple 中的全部类型
+template <typename Codec, typename Tuple>
+struct CodecAccepts;
+
+template <typename Codec, typename... Ts>
+struct CodecAccepts<Codec, std::tuple<Ts...>>
+    : std::bool_constant<(Codec::template accepts<Ts> && ...)> {};
+} // namespace trpc
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string_view>
+
+#include "trpc/buffer.hpp"
+#include "trpc/lz4.hpp"
+#include "trpc/message.h"
+#include "trpc/stats.hpp"
+
+namespace trpc {
+// 帧体压缩: body 不小于 threshold 时以 LZ4 块格式压缩, 帧头 flags 置 COMPRESSED_FLAG,
+// 压缩后的 body 为 [u32 原始长度 (小端)][LZ4 块]; 压缩后没有变小则照原样发送。
+// 请求中带 ACCEPT_COMPRESSED_FLAG 时服务端才会压缩响应, 因此与不支持压缩的一端仍可互通
+struct CompressionOptions {
+    bool enabled = false;
+    size_t threshold = 4096; // 只压缩不小于该长度的 body
+};
+
+// 单个 handler 的响应是否压缩, DEFAULT 表示沿用服务端的 CompressionOptions
+enum class Compression : uint8_t {
+    DEFAULT,
+    ENABLED,
+    DISABLED,
+};
+
+namespace compression {
+static constexpr size_t LENGTH_PREFIX = sizeof(uint32_t);
+// LZ4 的压缩率不超过 255:1, 声明的原始长度超过它时视为损坏, 避免按伪造的长度分配内存
+static constexpr size_t MAX_RATIO = 255;
+
+namespace detail {
+// 当前线程已使用的 CPU 时间; 没有 CLOCK_THREAD_CPUTIME_ID 的平台退化为单调时钟
+inline uint64_t thread_cpu_ns() {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + static_cast<uint64_t>(ts.tv_nsec);
+    }
+#endif
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+
+// 压缩输出的临时缓冲区, 每个线程一个
+inline Buffer& thread_scratch() {
+    static thread_local Buffer scratch;
+    return scratch;
+}
+} // namespace detail
+
+// frame 为已写好帧头的完整帧; body 足够大且压缩后变小时就地替换为压缩后的 body 并更新帧头。
+// CPU 时间计入 stats, 无论是否压缩成功
+inline bool compress_frame(Buffer& frame, size_t threshold, IoStats& stats) {
+    size_t body_len = frame.size() - RPC_HEAD_LEN;
+    if (body_len < threshold || body_len <= LENGTH_PREFIX) {
+        return false;
+    }
+    uint64_t start = detail::thread_cpu_ns();
+    Buffer& scratch = detail::thread_scratch();
+    size_t capacity = body_len - LENGTH_PREFIX - 1;
+    scratch.resize(capacity);
+    size_t compressed =
+        lz4::compress(frame.data() + RPC_HEAD_LEN, body_len, scratch.data(), capacity);
+    if (compressed > 0) {
+        store_u32_le(frame.data() + RPC_HEAD_LEN, static_cast<uint32_t>(body_len));
+        std::memcpy(frame.data() + RPC_HEAD_LEN + LENGTH_PREFIX, scratch.data(), compressed);
+        frame.resize(RPC_HEAD_LEN + LENGTH_PREFIX + compressed);
+        RpcHeader header;
+        std::memcpy(&header, frame.data(), RPC_HEAD_LEN);
+        header.body_len = static_cast<uint32_t>(frame.size() - RPC_HEAD_LEN);
+        header.flags |= COMPRESSED_FLAG;
+        std::memcpy(frame.data(), &header, RPC_HEAD_LEN);
+    }
+    if (scratch.capacity() > MAX_RETAINED_BUFFER_SIZE) {
+        scratch = Buffer();
+    }
+    stats.on_compress(compressed > 0, body_len, frame.size() - RPC_HEAD_LEN,
+                      detail::thread_cpu_ns() - start);
+    return compressed > 0;
+}
+
+// 解压带 COMPRESSED_FLAG 的 body 到 out (覆盖原有内容), body 损坏时返回 false
+inline bool decompress_body(std::string_view body, Buffer& out, IoStats& stats) {
+    uint64_t start = detail::thread_cpu_ns();
+    bool ok = body.size() > LENGTH_PREFIX;
+    size_t raw_len = ok ? load_u32_le(body.data()) : 0;
+    std::string_view block = ok ? body.substr(LENGTH_PREFIX) : std::string_view();
+    ok = ok && raw_len <= block.size() * MAX_RATIO;
+    if (ok) {
+        out.resize(raw_len);
+        ok = lz4::decompress(block.data(), block.size(), out.data(), raw_len);
+    }
+    stats.on_decompress(ok, detail::thread_cpu_ns() - start);
+    return ok;
+}
+} // namespace compression
+} // namespace trpc
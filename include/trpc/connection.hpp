@@ -1,42 +1,165 @@
 #pragma once
 
-#include <array>
-#include <deque>
+#include <chrono>
+#include <cstring>
 #include <memory>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
+#include <unistd.h>
+
 #include "asio.hpp"
 #include "clog/clog.h"
+#include "trpc/compression.hpp"
+#include "trpc/connection_registry.hpp"
 #include "trpc/message.h"
+#include "trpc/read_buffer.hpp"
+#include "trpc/responder.hpp"
 #include "trpc/router.hpp"
+#include "trpc/stats.hpp"
+#include "trpc/timing_wheel.hpp"
+#include "trpc/write_queue.hpp"
 
 namespace trpc {
-class Connection : public std::enable_shared_from_this<Connection>, public asio::noncopyable {
+class Connection;
+using IdleWheel = TimingWheel<Connection>;
+using Registry = ConnectionRegistry<Connection>;
+
+struct ConnectionOptions {
+    size_t timeout_seconds = 15; // 空闲超时, 0 表示不超时 (由 IdleWheel 检查)
+    size_t read_buffer_size = 64 * 1024;
+    WriteBatchLimit write_limit;
+    CompressionOptions compression; // 响应的压缩, 可被 handler 的设置覆盖
+};
+
+class Connection : public std::enable_shared_from_this<Connection>,
+                   public ResponseSink,
+                   public asio::noncopyable {
+    friend class ConnectionRegistry<Connection>;
+    using buffer_type = msgpack_codec::buffer_type;
+    using clock_type = std::chrono::steady_clock;
+    static constexpr size_t MAX_FREE_BUFFERS = 64;
+    // 流式响应: 每个连接同时进行的流数上限; 写队列中积压超过 STREAM_BUFFER_LIMIT 时暂停编码,
+    // 写完后继续。每个流的第一帧只带一个条目以尽快送达, 之后每帧的目标长度翻倍直到上限
+    static constexpr size_t MAX_STREAMS = 1024;
+    static constexpr size_t STREAM_BUFFER_LIMIT = 1024 * 1024;
+    static constexpr size_t STREAM_MIN_FRAME_BYTES = 1024;
+    static constexpr size_t STREAM_MAX_FRAME_BYTES = 64 * 1024;
+
 public:
-    Connection(asio::io_service* io_service, Router* router, size_t timeout_seconds)
+    // registry / idle_wheel 属于连接所在的 io_context; idle_wheel 为空表示不检查空闲超时
+    Connection(asio::io_service* io_service,
+               Router* router,
+               const ConnectionOptions& options,
+               IoStats* stats,
+               Registry* registry,
+               IdleWheel* idle_wheel)
         : socket_(*io_service),
           router_(router),
-          timer_(*io_service),
-          timeout_seconds_(timeout_seconds) {}
+          stats_(stats),
+          read_buffer_(options.read_buffer_size),
+          write_queue_(options.write_limit),
+          compression_(options.compression),
+          registry_(registry),
+          idle_wheel_(idle_wheel) {}
 
     ~Connection() { close(); }
 
-    void start() { read_head(); }
+    // 可在任意线程调用, 之后的操作都在连接所在的 io_context 中进行;
+    // 连接加入 registry, 关闭时自行移除
+    void start() {
+        asio::dispatch(socket_.get_executor(), [this, self = shared_from_this()] {
+            registry_->add(self);
+            if (idle_wheel_ != nullptr) {
+                last_active_ = idle_wheel_->now();
+                idle_wheel_->add(self);
+            }
+            do_read();
+            pump_streams(); // 迁移过来的流
+            flush();
+        });
+    }
+
     bool has_closed() const { return has_closed_; }
     asio::ip::tcp::socket& get_socket() { return socket_; }
     void set_conn_id(int64_t id) { conn_id_ = id; }
+    int64_t conn_id() const { return conn_id_; }
+
+    // 以下供 IdleWheel 调用
+    uint64_t last_active() const { return last_active_; }
+    bool on_idle_timeout() {
+        if (pending_tasks_ > 0 || !streams_.empty()) { // 仍有请求未应答或流未结束，不算空闲
+            return false;
+        }
+        CLOG_TRACE("connection id: {}, idle timeout, close...", conn_id_);
+        close();
+        return true;
+    }
+
+    // 以下供连接迁移使用, 只能在本连接的 io 线程中调用
+    // 最近一个采样周期内读到的帧数
+    uint64_t last_load() const { return last_load_; }
+    uint64_t sample_load() {
+        last_load_ = std::exchange(frames_since_sample_, 0);
+        return last_load_;
+    }
+
+    bool migrating() const { return migrate_target_ != nullptr; }
+
+    // 在两批请求之间把连接转交给 target (在目标 io_context 上新建、尚未 start 的连接):
+    // 暂停读取, 等正在进行的写完成后转交 socket、读缓冲区和未完成的请求计数;
+    // 之后才到达的异步响应经本对象转发给 target, 不会丢失
+    bool migrate_to(std::shared_ptr<Connection> target) {
+        if (has_closed_ || migrate_target_) {
+            return false;
+        }
+        migrate_target_ = std::move(target);
+        return true;
+    }
+
+    asio::any_io_executor get_executor() override { return socket_.get_executor(); }
+
+    // 由 Responder 或 WorkerPool 在任意线程调用, 在调用线程中压缩后回到本连接的 io 线程写出
+    void send_response(Buffer frame, const RpcHeader& request) override {
+        maybe_compress(frame, request);
+        run_in_owner([frame = std::move(frame)](Connection& conn) mutable {
+            --conn.pending_tasks_;
+            if (conn.has_closed_) {
+                return;
+            }
+            conn.write_queue_.push(std::move(frame));
+            conn.flush();
+        });
+    }
 
 private:
-    void read_head() {
-        reset_timer(); // 每次请求设定超时时间，超时则销毁当前链接
+    // 在连接当前所在的 io 线程中执行 f(Connection&); 已迁移时沿 moved_to_ 转发
+    template <typename F>
+    void run_in_owner(F&& f) {
+        asio::dispatch(socket_.get_executor(),
+                       [self = shared_from_this(), f = std::forward<F>(f)]() mutable {
+                           if (self->moved_to_) {
+                               self->moved_to_->run_in_owner(std::move(f));
+                               return;
+                           }
+                           f(*self);
+                       });
+    }
+
+    void do_read() {
+        reading_ = true;
+        read_buffer_.reserve_for_next();
         // 为保证回调执行时 connection 不会被销毁, 使用 shared_ptr 持有
-        asio::async_read(socket_, asio::buffer(head_buffer_.begin(), head_buffer_.size()),
-                         [this, self = this->shared_from_this()](asio::error_code ec, size_t len) {
-                             this->read_head_handler(ec, len);
-                         });
+        socket_.async_read_some(
+            read_buffer_.prepare(),
+            [this, self = this->shared_from_this()](asio::error_code ec, size_t len) {
+                this->on_read(ec, len);
+            });
     }
 
-    void read_head_handler(asio::error_code ec, size_t) {
+    void on_read(asio::error_code ec, size_t len) {
+        reading_ = false;
         if (!socket_.is_open()) {
             CLOG_WARN("socket already closed");
             return;
@@ -47,64 +170,277 @@ private:
             close();
             return;
         }
-        RpcHeader* header = reinterpret_cast<RpcHeader*>(head_buffer_.begin());
-        uint32_t body_len = header->body_len;
-        function_id_ = header->function_id;
-        request_id_ = header->request_id;
-        if (body_len == 0) { // 可能是心跳消息包
-            cancel_timer();
-            read_head();
+        read_buffer_.commit(len);
+        if (idle_wheel_ != nullptr) {
+            last_active_ = idle_wheel_->now();
+        }
+        auto arrival = clock_type::now();
+        // 处理本次读到的所有完整帧，响应积累在写队列中，最后一次性写出
+        RpcHeader header;
+        std::string_view body;
+        uint64_t frames = 0;
+        while (read_buffer_.next_frame(header, body)) {
+            ++frames;
+            if (header.body_len == 0) { // 可能是心跳消息包
+                continue;
+            }
+            if ((header.flags & COMPRESSED_FLAG) != 0) {
+                if (!compression::decompress_body(body, inflate_buffer_, *stats_)) {
+                    reject(header, "bad compressed body");
+                    continue;
+                }
+                body = std::string_view(inflate_buffer_.data(), inflate_buffer_.size());
+            }
+            if ((header.flags & STREAM_FLAG) != 0) {
+                on_stream_frame(header, body);
+                continue;
+            }
+            response_internal(header, body, deadline_of(header, arrival));
+        }
+        stats_->on_read_batch(frames);
+        frames_since_sample_ += frames;
+        if (inflate_buffer_.capacity() > MAX_RETAINED_BUFFER_SIZE) {
+            inflate_buffer_ = Buffer();
+        }
+        pump_streams();
+        flush();
+        if (migrate_target_) { // 不再读取, 写完成后转交
+            try_hand_over();
             return;
         }
-        read_body(body_len);
+        do_read();
     }
 
-    void read_body(size_t len) {
-        if (body_buffer_.size() < len) {
-            body_buffer_.resize(len);
+    static clock_type::time_point deadline_of(const RpcHeader& request,
+                                              clock_type::time_point arrival) {
+        if (request.timeout_ms == 0) {
+            return clock_type::time_point::max();
         }
-        asio::async_read(socket_, asio::buffer(body_buffer_.data(), len),
-                         [this, self = this->shared_from_this()](asio::error_code ec, size_t len) {
-                             this->read_body_handler(ec, len);
-                         });
+        return arrival + std::chrono::milliseconds(request.timeout_ms);
     }
 
-    void read_body_handler(asio::error_code ec, size_t len) {
-        cancel_timer();
-        if (!socket_.is_open()) {
-            CLOG_WARN("socket already closed");
+    // 客户端已经放弃的请求不再执行, 也不发送响应
+    bool expired(clock_type::time_point deadline) const {
+        if (deadline == clock_type::time_point::max() || clock_type::now() < deadline) {
+            return false;
+        }
+        stats_->expired.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void response_internal(const RpcHeader& request,
+                           std::string_view args,
+                           clock_type::time_point deadline) {
+        const Router::Entry* handler = router_->find(request.function_id);
+        if (handler != nullptr && handler->executor != nullptr) {
+            dispatch_to_executor(handler, request, args, deadline);
             return;
         }
-        if (ec) {
-            CLOG_WARN("{}: {}", ec.value(), ec.message());
-            close();
+        if (expired(deadline)) {
+            return;
+        }
+        if (handler != nullptr && handler->is_async(codec_of(request))) {
+            ++pending_tasks_;
+            handler->owner->async_func(args, Responder(shared_from_this(), request));
+            return;
+        }
+        auto buffer = buffer_pool_.acquire(msgpack_codec::init_size);
+        encode_response(buffer, request, handler, args);
+        maybe_compress(buffer, request);
+        write_queue_.push(std::move(buffer));
+    }
+
+    // 请求方能够解压且 handler (或服务端默认) 开启了压缩时压缩响应帧
+    void maybe_compress(Buffer& frame, const RpcHeader& request) {
+        if ((request.flags & ACCEPT_COMPRESSED_FLAG) == 0 ||
+            frame.size() - RPC_HEAD_LEN < compression_.threshold) {
+            return;
+        }
+        const Router::Entry* handler = router_->find(request.function_id);
+        Compression setting = handler == nullptr ? Compression::DEFAULT : handler->compression;
+        if (setting == Compression::ENABLED ||
+            (setting == Compression::DEFAULT && compression_.enabled)) {
+            compression::compress_frame(frame, compression_.threshold, *stats_);
+        }
+    }
+
+    // 无法处理的请求直接返回 FAIL; 流式请求以结束帧返回
+    void reject(const RpcHeader& request, std::string_view message) {
+        auto buffer = buffer_pool_.acquire(msgpack_codec::init_size);
+        buffer.resize(RPC_HEAD_LEN);
+        msgpack_codec::pack_args_to(buffer, FuncResultCode::FAIL, message);
+        uint32_t flags = (request.flags & STREAM_FLAG) != 0 ? STREAM_FLAG | STREAM_END_FLAG : 0;
+        write_response_header(buffer, request, CodecType::MSGPACK, flags);
+        write_queue_.push(std::move(buffer));
+    }
+
+    // 服务端的一个流, 只在 io 线程中访问
+    struct ServerStream {
+        RpcHeader request; // 打开流的请求, 响应帧沿用其 request_id 并据此决定是否压缩
+        Router::Handler::StreamNext next;
+        uint64_t credits{0};    // 还可以发送的条目数
+        size_t frame_bytes{0};  // 下一帧的目标长度, 0 表示只带一个条目
+    };
+
+    // 打开流或处理客户端的 credit/cancel 帧
+    void on_stream_frame(const RpcHeader& header, std::string_view body) {
+        if ((header.flags & (STREAM_CREDIT_FLAG | STREAM_CANCEL_FLAG)) != 0) {
+            auto it = streams_.find(header.request_id);
+            if (it == streams_.end()) {
+                return; // 已经结束的流
+            }
+            if ((header.flags & STREAM_CANCEL_FLAG) != 0) {
+                streams_.erase(it);
+            } else if (body.size() >= sizeof(uint32_t)) {
+                it->second.credits += load_u32_le(body.data());
+            }
             return;
         }
-        read_head();
-        std::string function_result =
-            router_->route(function_id_, std::string_view(body_buffer_.data(), len));
-        response_internal(std::move(function_result));
+        const Router::Entry* handler = router_->find(header.function_id);
+        if (handler == nullptr) {
+            reject(header, "unknown function");
+            return;
+        }
+        if (handler->kind != Router::Entry::Kind::STREAM) {
+            reject(header, "not a stream function");
+            return;
+        }
+        if (codec_of(header) != CodecType::MSGPACK) {
+            reject(header, "codec not supported");
+            return;
+        }
+        if (streams_.size() >= MAX_STREAMS || streams_.count(header.request_id) != 0) {
+            reject(header, "too many streams");
+            return;
+        }
+        try {
+            streams_.emplace(header.request_id, ServerStream{header, handler->owner->stream_func(body)});
+        } catch (const std::exception& e) {
+            reject(header, e.what());
+        }
+    }
+
+    // 在 credit 与写队列积压允许的范围内为各个流编码后续条目, 结束的流随之移除
+    void pump_streams() {
+        for (auto it = streams_.begin(); it != streams_.end();) {
+            it = pump(it->second) ? streams_.erase(it) : std::next(it);
+        }
+    }
+
+    // 流结束 (生成器返回空或抛出异常) 时写出结束帧并返回 true
+    bool pump(ServerStream& stream) {
+        while (stream.credits > 0 && write_queue_.pending_bytes() < STREAM_BUFFER_LIMIT) {
+            // body 为 (OK, [条目...]), 条目数写在定长的 array32 头中, 编码完再填入
+            auto frame = buffer_pool_.acquire(msgpack_codec::init_size);
+            frame.resize(RPC_HEAD_LEN);
+            static constexpr char ITEMS_HEAD[] = {'\x92', '\x00', '\xdd', 0, 0, 0, 0};
+            frame.write(ITEMS_HEAD, sizeof(ITEMS_HEAD));
+            size_t items_begin = frame.size();
+            uint32_t count = 0;
+            bool more = true;
+            std::string error;
+            while (stream.credits > 0) {
+                size_t mark = frame.size();
+                try {
+                    more = stream.next(frame);
+                } catch (const std::exception& e) {
+                    more = false;
+                    error = e.what();
+                }
+                if (more && frame.size() - RPC_HEAD_LEN > UINT32_MAX) {
+                    more = false;
+                    error = "result too long";
+                }
+                if (!more) {
+                    frame.resize(mark);
+                    break;
+                }
+                ++count;
+                --stream.credits;
+                if (frame.size() - items_begin >= stream.frame_bytes) {
+                    break;
+                }
+            }
+            if (count > 0) {
+                for (size_t i = 0; i < sizeof(uint32_t); ++i) { // msgpack 为大端序
+                    frame.data()[items_begin - 1 - i] = static_cast<char>(count >> (8 * i));
+                }
+                write_response_header(frame, stream.request, CodecType::MSGPACK, STREAM_FLAG);
+                maybe_compress(frame, stream.request);
+                write_queue_.push(std::move(frame));
+                flush(); // 不等整批编码完, 尽快开始写出
+                stream.frame_bytes = std::min(std::max(stream.frame_bytes * 2, STREAM_MIN_FRAME_BYTES),
+                                              STREAM_MAX_FRAME_BYTES);
+            } else {
+                buffer_pool_.release(std::move(frame));
+            }
+            if (!more) {
+                auto end = buffer_pool_.acquire(msgpack_codec::init_size);
+                end.resize(RPC_HEAD_LEN);
+                if (error.empty()) {
+                    msgpack_codec::pack_args_to(end, FuncResultCode::OK);
+                } else {
+                    msgpack_codec::pack_args_to(end, FuncResultCode::FAIL, error);
+                }
+                write_response_header(end, stream.request, CodecType::MSGPACK,
+                                      STREAM_FLAG | STREAM_END_FLAG);
+                write_queue_.push(std::move(end));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 结果直接编码到帧缓冲区中，前 RPC_HEAD_LEN 字节预留给帧头
+    static void encode_response(buffer_type& buffer,
+                                const RpcHeader& request,
+                                const Router::Entry* handler,
+                                std::string_view args) {
+        buffer.resize(RPC_HEAD_LEN);
+        CodecType codec = Router::invoke(handler, codec_of(request), args, buffer);
+        write_response_header(buffer, request, codec);
+    }
+
+    // 在 WorkerPool 中执行 handler, 结果经 send_response 回到本连接的 io_context 再写出。
+    // 读缓冲区在本批处理后会被复用，因此参数需要拷贝一份。
+    void dispatch_to_executor(const Router::Entry* handler,
+                              const RpcHeader& request,
+                              std::string_view args,
+                              clock_type::time_point deadline) {
+        ++pending_tasks_;
+        auto task = [this, self = shared_from_this(), handler, request, deadline,
+                     body = std::string(args)] {
+            if (expired(deadline)) { // 在队列中等待时已超时
+                run_in_owner([](Connection& conn) { --conn.pending_tasks_; });
+                return;
+            }
+            if (handler->is_async(codec_of(request))) {
+                handler->owner->async_func(body, Responder(self, request));
+                return;
+            }
+            buffer_type buffer(msgpack_codec::init_size);
+            encode_response(buffer, request, handler, body);
+            send_response(std::move(buffer), request);
+        };
+        if (!handler->executor->try_post(std::move(task))) {
+            --pending_tasks_;
+            reject(request, "server busy");
+        }
     }
 
-    void response_internal(std::string function_result) {
-        RpcMsg msg{};
-        msg.header =
-            RpcHeader{request_id_, static_cast<uint32_t>(function_result.size()), function_id_};
-        msg.content = std::move(function_result);
-        write_queue_.emplace_back(std::move(msg));
-        if (write_queue_.size() > 1) {
-            // 上次注册的 write 事件还未执行，不要重复注册
+    void flush() {
+        if (write_queue_.writing() || !write_queue_.has_pending()) {
+            // 上次注册的 write 事件还未执行，不要重复注册; 完成后会把积累的帧一次写出
             return;
         }
         write();
     }
 
+    // 将队列中的帧合并为一次 gather write
     void write() {
-        auto& msg = write_queue_.front();
-        std::array<asio::const_buffer, 2> write_buffers;
-        write_buffers[0] = asio::buffer(&msg.header, sizeof(msg.header));
-        write_buffers[1] = asio::buffer(msg.content.data(), msg.content.size());
-        asio::async_write(socket_, write_buffers,
+        BatchBuffers buffers = write_queue_.next_batch();
+        stats_->on_write_batch(write_queue_.batch_frames(), write_queue_.batch_bytes());
+        asio::async_write(socket_, buffers,
                           [this, self = this->shared_from_this()](asio::error_code ec, size_t len) {
                               this->on_written(ec, len);
                           });
@@ -116,10 +452,47 @@ private:
             close();
             return;
         }
-        write_queue_.pop_front();
-        if (!write_queue_.empty()) {
-            write();
+        write_queue_.finish_batch(buffer_pool_);
+        pump_streams();
+        flush();
+        if (migrate_target_) {
+            try_hand_over();
+        }
+    }
+
+    // 没有进行中的读写时才能释放 socket
+    void try_hand_over() {
+        if (has_closed_ || reading_ || write_queue_.writing() || write_queue_.has_pending()) {
+            return;
+        }
+        auto target = std::move(migrate_target_);
+        asio::error_code ec;
+        auto protocol = socket_.local_endpoint(ec).protocol();
+        if (!ec) {
+            auto handle = socket_.release(ec);
+            if (!ec) {
+                target->socket_.assign(protocol, handle, ec);
+                if (ec) {
+                    ::close(handle);
+                }
+            }
+        }
+        if (ec) {
+            CLOG_WARN("migrate connection {} failed, {}: {}", conn_id_, ec.value(), ec.message());
+            close();
+            return;
         }
+        target->conn_id_ = conn_id_;
+        target->pending_tasks_ = std::exchange(pending_tasks_, 0);
+        target->read_buffer_ = std::move(read_buffer_);
+        target->buffer_pool_ = std::move(buffer_pool_);
+        target->streams_ = std::move(streams_);
+        moved_to_ = target;
+        has_closed_ = true; // 本对象不再读写, IdleWheel 会将其丢弃
+        stats_->migrations.fetch_add(1, std::memory_order_relaxed);
+        CLOG_TRACE("connection id: {} migrated", conn_id_);
+        leave_registry();
+        target->start();
     }
 
     void close() {
@@ -131,43 +504,42 @@ private:
         socket_.shutdown(asio::ip::tcp::socket::shutdown_both, ec);
         socket_.close(ec);
         has_closed_ = true;
+        migrate_target_.reset();
+        leave_registry();
     }
 
-    void reset_timer() {
-        if (timeout_seconds_ == 0) {
-            return;
+    void leave_registry() {
+        // registry 可能持有最后一个引用, 移除期间先保持自身存活
+        if (registry_index_ != Registry::NPOS) {
+            auto self = weak_from_this().lock();
+            registry_->remove(*this);
         }
-        CLOG_TRACE("connection id: {}, reset timer.", conn_id_);
-        timer_.expires_from_now(std::chrono::seconds(timeout_seconds_));
-        timer_.async_wait([this, self = this->shared_from_this()](asio::error_code ec) {
-            if (this->has_closed() || ec) {
-                return;
-            }
-            CLOG_TRACE("connection id: {}, timer expired, close...", conn_id_);
-            this->close();
-        });
     }
 
-    void cancel_timer() {
-        if (timeout_seconds_ == 0) {
-            return;
-        }
-        timer_.cancel();
-    }
-
-    std::array<char, RPC_HEAD_LEN> head_buffer_;
-    std::vector<char> body_buffer_;
-    uint64_t request_id_{0};
-    uint32_t function_id_{0};
-
     bool has_closed_{false};
+    bool reading_{false}; // 有进行中的 async_read_some
     int64_t conn_id_{0};
+    size_t pending_tasks_{0}; // 尚未写回的 WorkerPool/异步 handler 请求数, 只在 io 线程中访问
 
     asio::ip::tcp::socket socket_;
     Router* router_;
-    std::deque<RpcMsg> write_queue_;
+    IoStats* stats_;
+    ReadBuffer read_buffer_;
+    // 已发送的帧缓冲区回收到 buffer_pool_ 中复用
+    WriteQueue write_queue_;
+    BufferPool buffer_pool_{MAX_FREE_BUFFERS, MAX_RETAINED_BUFFER_SIZE};
+    const CompressionOptions compression_;
+    Buffer inflate_buffer_; // 解压后的请求参数, 只在处理该帧期间使用
+    std::unordered_map<uint64_t, ServerStream> streams_; // 以 request_id 为键
+
+    Registry* registry_;
+    size_t registry_index_{Registry::NPOS}; // 由 registry_ 维护
+    IdleWheel* idle_wheel_;
+    uint64_t last_active_{0}; // 最近一次读到数据时的 idle_wheel_->now()
 
-    asio::steady_timer timer_; // 超时关闭当前 connection
-    size_t timeout_seconds_;
+    uint64_t frames_since_sample_{0};
+    uint64_t last_load_{0};
+    std::shared_ptr<Connection> migrate_target_; // 等待转交的目标连接
+    std::shared_ptr<Connection> moved_to_;       // 已转交, 之后的响应转发给它
 };
 } // namespace trpc
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "asio.hpp"
+#include "asio/detail/noncopyable.hpp"
+#include "clog/clog.h"
+#include "trpc/connection.hpp"
+#include "trpc/io_service_pool.hpp"
+
+namespace trpc {
+struct BalanceOptions {
+    size_t interval_ms = 0;       // 采样周期, 0 表示不迁移连接
+    double imbalance_ratio = 1.5; // 最忙的 io_context 的负载超过平均值的倍数时视为不均衡
+    size_t sustain_periods = 3;   // 连续多少个周期不均衡才迁移
+    uint64_t min_frames = 1000;   // 每周期读到的帧数低于此值的 io_context 不视为过载
+};
+
+// 按 io_context 统计负载 (每个采样周期读到的帧数), 持续不均衡时把最忙的 io_context 上
+// 合适的一个连接迁移到最闲的 io_context, 每个周期最多迁移一个。
+// 采样在各 io 线程中进行, 决策在定时器所在的 io 线程中使用上一周期的结果。
+class ConnectionBalancer : asio::noncopyable {
+public:
+    // 在指定 io_context 上新建一个未 start 的连接, 作为迁移目标
+    using ConnectionFactory = std::function<std::shared_ptr<Connection>(size_t index)>;
+
+    ConnectionBalancer(IoServicePool& pool,
+                       const std::vector<std::unique_ptr<Registry>>& registries,
+                       ConnectionFactory factory,
+                       const BalanceOptions& options)
+        : pool_(pool),
+          registries_(registries),
+          factory_(std::move(factory)),
+          options_(options),
+          loads_(registries.size()),
+          timer_(pool.get_io_service(0)) {
+        schedule();
+    }
+
+    ~ConnectionBalancer() { timer_.cancel(); }
+
+private:
+    void schedule() {
+        timer_.expires_after(std::chrono::milliseconds(options_.interval_ms));
+        timer_.async_wait([this](asio::error_code ec) {
+            if (ec) {
+                return;
+            }
+            rebalance();
+            sample();
+            schedule();
+        });
+    }
+
+    void sample() {
+        for (size_t i = 0; i < registries_.size(); ++i) {
+            asio::post(pool_.get_io_service(i), [this, i] {
+                uint64_t load = 0;
+                registries_[i]->for_each(
+                    [&load](Connection& conn) { load += conn.sample_load(); });
+                loads_[i].store(load, std::memory_order_relaxed);
+            });
+        }
+    }
+
+    void rebalance() {
+        size_t hot = 0;
+        size_t cold = 0;
+        uint64_t total = 0;
+        std::vector<uint64_t> loads(loads_.size());
+        for (size_t i = 0; i < loads.size(); ++i) {
+            loads[i] = loads_[i].load(std::memory_order_relaxed);
+            total += loads[i];
+            if (loads[i] > loads[hot]) {
+                hot = i;
+            }
+            if (loads[i] < loads[cold]) {
+                cold = i;
+            }
+        }
+        double average = static_cast<double>(total) / static_cast<double>(loads.size());
+        bool imbalanced = loads[hot] >= options_.min_frames &&
+                          static_cast<double>(loads[hot]) > average * options_.imbalance_ratio;
+        if (!imbalanced) {
+            streak_ = 0;
+            return;
+        }
+        streak_ = hot == last_hot_ ? streak_ + 1 : 1;
+        last_hot_ = hot;
+        if (streak_ < options_.sustain_periods) {
+            return;
+        }
+        streak_ = 0;
+        asio::post(pool_.get_io_service(hot),
+                   [this, hot, cold, from = loads[hot], to = loads[cold]] {
+                       migrate_one(hot, cold, from, to);
+                   });
+    }
+
+    // 在 hot 的 io 线程中执行: 选择迁移后两边最大负载最小的连接, 负载不会因此下降时不迁移
+    void migrate_one(size_t hot, size_t cold, uint64_t from, uint64_t to) {
+        Connection* best = nullptr;
+        uint64_t best_peak = from;
+        registries_[hot]->for_each([&](Connection& conn) {
+            uint64_t load = conn.last_load();
+            if (load == 0 || load > from || conn.migrating() || conn.has_closed()) {
+                return;
+            }
+            uint64_t peak = std::max(from - load, to + load);
+            if (peak < best_peak) {
+                best = &conn;
+                best_peak = peak;
+            }
+        });
+        if (best == nullptr) {
+            return;
+        }
+        CLOG_INFO("migrate connection {} from io_context {} to {}, load {} -> {}",
+                  best->conn_id(), hot, cold, from, best_peak);
+        best->migrate_to(factory_(cold));
+    }
+
+    IoServicePool& pool_;
+    const std::vector<std::unique_ptr<Registry>>& registries_;
+    ConnectionFactory factory_;
+    BalanceOptions options_;
+    std::vector<std::atomic<uint64_t>> loads_; // 各 io_context 上一周期的负载
+    asio::steady_timer timer_;
+    size_t last_hot_{0};
+    size_t streak_{0};
+};
+} // namespace trpc
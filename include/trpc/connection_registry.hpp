@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "asio/detail/noncopyable.hpp"
+
+namespace trpc {
+// 单个 io_context 上的连接集合，持有连接的 shared_ptr。
+// 除 size() 外只能在该 io_context 的线程中使用，因此不需要加锁;
+// 每个连接记录自己在数组中的下标 (T::registry_index_), 关闭时与末尾元素交换后删除, O(1)。
+template <typename T>
+class ConnectionRegistry : asio::noncopyable {
+public:
+    static constexpr size_t NPOS = SIZE_MAX;
+
+    ~ConnectionRegistry() {
+        // 连接析构时会尝试把自己移除，先解除关联
+        auto entries = std::move(entries_);
+        for (auto& entry : entries) {
+            entry->registry_index_ = NPOS;
+        }
+    }
+
+    void add(std::shared_ptr<T> entry) {
+        entry->registry_index_ = entries_.size();
+        entries_.push_back(std::move(entry));
+        size_.store(entries_.size(), std::memory_order_relaxed);
+    }
+
+    // 调用者需保证 entry 在返回前仍然有效 (此处可能释放最后一个引用)
+    void remove(T& entry) {
+        size_t index = entry.registry_index_;
+        if (index == NPOS) {
+            return;
+        }
+        entry.registry_index_ = NPOS;
+        if (index != entries_.size() - 1) {
+            std::swap(entries_[index], entries_.back());
+            entries_[index]->registry_index_ = index;
+        }
+        entries_.pop_back();
+        size_.store(entries_.size(), std::memory_order_relaxed);
+    }
+
+    template <typename F>
+    void for_each(F&& f) {
+        for (auto& entry : entries_) {
+            f(*entry);
+        }
+    }
+
+    // 可在任意线程调用
+    size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<std::shared_ptr<T>> entries_;
+    std::atomic<size_t> size_{0};
+};
+} // namespace trpc
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "trpc/md5.hpp"
+
+namespace trpc {
+// 函数 id: 函数名 MD5 的前 4 个字节, 客户端以此指定要调用的函数。
+// 可由函数名隐式构造 (每次调用都要计算哈希), 也可以预先算好:
+//   static constexpr trpc::FuncId ADD = trpc::func_id("add"); // 编译期求值
+//   client.call<int>(ADD, 1, 2);
+struct FuncId {
+    constexpr explicit FuncId(uint32_t id)
+        : value(id) {}
+    constexpr FuncId(std::string_view name)
+        : value(MD5::MD5Hash32(name.data(), static_cast<uint32_t>(name.size()))) {}
+    constexpr FuncId(const char* name)
+        : FuncId(std::string_view(name)) {}
+    FuncId(const std::string& name)
+        : FuncId(std::string_view(name)) {}
+
+    uint32_t value;
+};
+
+constexpr FuncId func_id(std::string_view name) { return FuncId(name); }
+
+namespace literals {
+// "add"_func, 在常量表达式中使用时于编译期求值
+constexpr FuncId operator""_func(const char* name, size_t len) {
+    return FuncId(std::string_view(name, len));
+}
+} // namespace literals
+} // namespace trpc
@@ -1,36 +1,74 @@
 #pragma once
 
+#include <cstdio>
+#include <fstream>
 #include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
 #include <vector>
 
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 #include "asio.hpp"
 #include "asio/detail/noncopyable.hpp"
 #include "asio/steady_timer.hpp"
 #include "clog/clog.h"
 
 namespace trpc {
+struct IoServicePoolOptions {
+    // 传给 asio::io_context 的并发提示。每个 io_context 只由一个线程运行, 默认为 1。
+    // 不能去掉 reactor I/O 的锁 (如 ASIO_CONCURRENCY_HINT_UNSAFE_IO): 轮转 accept 在其他 io_context
+    // 上创建 socket, 连接迁移跨线程 assign socket, RpcClient 也在调用者线程中发起写
+    int concurrency_hint = 1;
+    bool pin_threads = false; // 将第 i 个 io 线程绑定到 cpus[i % cpus.size()] (仅 Linux)
+    std::vector<int> cpus;    // 为空时按 NUMA 节点顺序使用本进程允许的 CPU, 见 default_cpus()
+};
+
 class IoServicePool : public asio::noncopyable {
 public:
-    explicit IoServicePool(size_t pool_size)
+    explicit IoServicePool(size_t pool_size, const IoServicePoolOptions& options = {})
         : io_service_index_(0) {
         if (pool_size == 0) {
             CLOG_ERROR("IoServicePool size should > 0");
             exit(-1);
         }
+        if (!ASIO_CONCURRENCY_HINT_IS_LOCKING(REACTOR_IO, options.concurrency_hint)) {
+            CLOG_ERROR("IoServicePool requires a concurrency hint with reactor I/O locking");
+            exit(-1);
+        }
         for (size_t i = 0; i < pool_size; ++i) {
-            auto io_service = std::make_shared<asio::io_context>();
+            auto io_service = std::make_shared<asio::io_context>(options.concurrency_hint);
             auto io_work = std::make_shared<asio::io_context::work>(*io_service);
             io_services_.push_back(io_service);
             io_works_.push_back(io_work);
         }
+        if (options.pin_threads) {
+            cpus_ = options.cpus.empty() ? default_cpus() : options.cpus;
+            std::string list;
+            for (size_t i = 0; i < pool_size && !cpus_.empty(); ++i) {
+                list += (i == 0 ? "" : ",") + std::to_string(cpus_[i % cpus_.size()]);
+            }
+            CLOG_INFO("pin io threads to cpus [{}]", list);
+        }
     }
 
     void run() {
         // one io_service per thread
         std::vector<std::thread> threads;
         for (size_t i = 0; i < io_services_.size(); ++i) {
-            threads.emplace_back(
-                std::thread([](io_service_ptr service) { service->run(); }, io_services_[i]));
+            threads.emplace_back(std::thread(
+                [this, i](io_service_ptr service) {
+                    if (!cpus_.empty()) {
+                        pin_current_thread(cpus_[i % cpus_.size()]);
+                    }
+                    service->run();
+                },
+                io_services_[i]));
         }
         CLOG_INFO("Run io_service pool of {} threads", threads.size());
         for (auto& t : threads) {
@@ -44,18 +82,104 @@ public:
         }
     }
 
-    asio::io_context& next_io_service() {
-        asio::io_context& io_service = *io_services_[io_service_index_++];
+    asio::io_context& next_io_service() { return *io_services_[next_index()]; }
+
+    // 轮转选择下一个 io_context 的下标, 供需要按 io_context 维护状态的使用者
+    size_t next_index() {
+        size_t index = io_service_index_++;
         io_service_index_ %= io_services_.size();
-        return io_service;
+        return index;
+    }
+
+    asio::io_context& get_io_service(size_t index) { return *io_services_[index]; }
+    size_t size() const { return io_services_.size(); }
+
+    // 本进程允许使用的 CPU, 按 NUMA 节点分组排列: 先排满节点 0 再到节点 1 ...
+    // 线程数不超过一个节点的 CPU 数时, 所有 io 线程都在同一节点上, 共享缓存和本地内存
+    static std::vector<int> default_cpus() {
+        std::set<int> allowed = allowed_cpus();
+        std::vector<int> cpus;
+        for (int node = 0;; ++node) {
+            std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) +
+                               "/cpulist");
+            if (!file) {
+                break;
+            }
+            std::string list;
+            std::getline(file, list);
+            for (int cpu : parse_cpu_list(list)) {
+                if (allowed.erase(cpu) > 0) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+        // 没有 NUMA 信息或不在任何节点中的 CPU 按编号追加
+        cpus.insert(cpus.end(), allowed.begin(), allowed.end());
+        return cpus;
+    }
+
+    // 解析 "0-3,8,10-11" 格式的 CPU 列表
+    static std::vector<int> parse_cpu_list(const std::string& list) {
+        std::vector<int> cpus;
+        std::stringstream ss(list);
+        std::string range;
+        while (std::getline(ss, range, ',')) {
+            int first = 0;
+            int last = 0;
+            int n = std::sscanf(range.c_str(), "%d-%d", &first, &last);
+            if (n == 1) {
+                last = first;
+            } else if (n != 2) {
+                continue;
+            }
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+        return cpus;
     }
 
 private:
+    static std::set<int> allowed_cpus() {
+        std::set<int> cpus;
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &set)) {
+                    cpus.insert(cpu);
+                }
+            }
+            return cpus;
+        }
+#endif
+        for (unsigned cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu) {
+            cpus.insert(static_cast<int>(cpu));
+        }
+        return cpus;
+    }
+
+    static void pin_current_thread(int cpu) {
+#if defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (ret != 0) {
+            CLOG_WARN("failed to pin io thread to cpu {}: {}", cpu, ret);
+        }
+#else
+        CLOG_WARN("thread pinning is not supported on this platform, cpu {}", cpu);
+#endif
+    }
+
     using io_service_ptr = std::shared_ptr<asio::io_context>;
     using io_work_ptr = std::shared_ptr<asio::io_context::work>;
 
     std::vector<io_service_ptr> io_services_;
     std::vector<io_work_ptr> io_works_;
     size_t io_service_index_{0};
+    std::vector<int> cpus_; // 为空表示不绑定
 };
-} // namespace trpc
\ No newline at end of file
+} // namespace trpc
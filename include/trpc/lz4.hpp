@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace trpc {
+// LZ4 块格式 (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md) 的简单实现,
+// 输出可由标准 LZ4_decompress_safe 解压。只做单块, 不包含帧格式和校验, 长度由调用者另行保存。
+// 每个序列: token (高 4 位字面量长度, 低 4 位匹配长度 - 4), 字面量, 2 字节小端偏移, 长度扩展字节
+namespace lz4 {
+static constexpr size_t MIN_MATCH = 4;
+static constexpr size_t LAST_LITERALS = 5; // 块的最后 5 字节必须是字面量
+static constexpr size_t MF_LIMIT = 12;     // 最后一个匹配至少在块结束前 12 字节开始
+static constexpr size_t MAX_DISTANCE = 65535;
+static constexpr int HASH_LOG = 12;
+static constexpr size_t SKIP_TRIGGER = 6; // 连续 2^6 次未匹配后步长加 1, 快速跳过不可压缩的数据
+static constexpr size_t WILD_COPY = 16;   // 两端余量足够时按固定长度整块复制, 允许多写
+
+namespace detail {
+inline uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint64_t read64(const uint8_t* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t hash(uint32_t sequence) { return (sequence * 2654435761u) >> (32 - HASH_LOG); }
+
+// 长度 >= 15 时 token 中记 15, 其余依次写 255... 和最后一个 < 255 的字节
+inline uint8_t* write_length(uint8_t* op, size_t len) {
+    for (len -= 15; len >= 255; len -= 255) {
+        *op++ = 255;
+    }
+    *op++ = static_cast<uint8_t>(len);
+    return op;
+}
+
+inline size_t length_bytes(size_t len) { return len < 15 ? 0 : (len - 15) / 255 + 1; }
+
+// 读取长度扩展字节, 越界返回 false
+inline bool read_length(const uint8_t*& ip, const uint8_t* end, size_t& len) {
+    uint8_t b;
+    do {
+        if (ip >= end) {
+            return false;
+        }
+        b = *ip++;
+        len += b;
+    } while (b == 255);
+    return true;
+}
+
+// 写一个序列: 字面量 [literal, literal + literal_len) 与 (offset, match_len);
+// match_len 为 0 表示只有字面量的最后一个序列。in_end 为输入的末尾, 空间不足返回 nullptr
+inline uint8_t* write_sequence(uint8_t* op,
+                               const uint8_t* out_end,
+                               const uint8_t* in_end,
+                               const uint8_t* literal,
+                               size_t literal_len,
+                               size_t offset,
+                               size_t match_len) {
+    size_t need = 1 + length_bytes(literal_len) + literal_len;
+    size_t match_code = match_len == 0 ? 0 : match_len - MIN_MATCH;
+    if (match_len != 0) {
+        need += 2 + length_bytes(match_code);
+    }
+    if (static_cast<size_t>(out_end - op) < need) {
+        return nullptr;
+    }
+    uint8_t* token = op++;
+    *token = static_cast<uint8_t>(std::min<size_t>(literal_len, 15) << 4);
+    if (literal_len >= 15) {
+        op = write_length(op, literal_len);
+    }
+    if (literal_len <= WILD_COPY && static_cast<size_t>(in_end - literal) >= WILD_COPY &&
+        static_cast<size_t>(out_end - op) >= WILD_COPY) {
+        std::memcpy(op, literal, WILD_COPY);
+    } else if (literal_len > 0) {
+        std::memcpy(op, literal, literal_len);
+    }
+    op += literal_len;
+    if (match_len == 0) {
+        return op;
+    }
+    *op++ = static_cast<uint8_t>(offset);
+    *op++ = static_cast<uint8_t>(offset >> 8);
+    *token |= static_cast<uint8_t>(std::min<size_t>(match_code, 15));
+    if (match_code >= 15) {
+        op = write_length(op, match_code);
+    }
+    return op;
+}
+} // namespace detail
+
+// 压缩 [src, src + len) 到 dst, 返回压缩后的长度; 结果超过 capacity 时返回 0
+inline size_t compress(const char* src, size_t len, char* dst, size_t capacity) {
+    const auto* base = reinterpret_cast<const uint8_t*>(src);
+    const uint8_t* end = base + len;
+    const uint8_t* anchor = base; // 尚未输出的字面量起点
+    auto* out = reinterpret_cast<uint8_t*>(dst);
+    uint8_t* op = out;
+    const uint8_t* out_end = out + capacity;
+
+    if (len > MF_LIMIT) {
+        const uint8_t* match_start_limit = end - MF_LIMIT;
+        const uint8_t* match_end_limit = end - LAST_LITERALS;
+        uint32_t table[1 << HASH_LOG] = {}; // 各 hash 最近出现的位置
+        const uint8_t* ip = base;
+        size_t attempts = size_t(1) << SKIP_TRIGGER;
+        while (ip < match_start_limit) {
+            uint32_t sequence = detail::read32(ip);
+            uint32_t h = detail::hash(sequence);
+            const uint8_t* ref = base + table[h];
+            table[h] = static_cast<uint32_t>(ip - base);
+            if (ref >= ip || static_cast<size_t>(ip - ref) > MAX_DISTANCE ||
+                detail::read32(ref) != sequence) {
+                ip += attempts++ >> SKIP_TRIGGER;
+                continue;
+            }
+            while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+                --ip;
+                --ref;
+            }
+            const uint8_t* mp = ip + MIN_MATCH;
+            const uint8_t* rp = ref + MIN_MATCH;
+            while (mp + 8 <= match_end_limit && detail::read64(mp) == detail::read64(rp)) {
+                mp += 8;
+                rp += 8;
+            }
+            while (mp < match_end_limit && *mp == *rp) {
+                ++mp;
+                ++rp;
+            }
+            op = detail::write_sequence(
+                op, out_end, end, anchor, static_cast<size_t>(ip - anchor),
+                static_cast<size_t>(ip - ref), static_cast<size_t>(mp - ip));
+            if (op == nullptr) {
+                return 0;
+            }
+            ip = anchor = mp;
+            attempts = size_t(1) << SKIP_TRIGGER;
+            if (ip < match_start_limit) { // 匹配末尾附近的位置也加入表中, 提高下一次命中率
+                table[detail::hash(detail::read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - base);
+            }
+        }
+    }
+    op = detail::write_sequence(op, out_end, end, anchor, static_cast<size_t>(end - anchor), 0, 0);
+    return op == nullptr ? 0 : static_cast<size_t>(op - out);
+}
+
+// 解压到 dst, 必须恰好得到 out_len 字节; 输入损坏或长度不符时返回 false, 不会越界读写
+inline bool decompress(const char* src, size_t len, char* dst, size_t out_len) {
+    const auto* ip = reinterpret_cast<const uint8_t*>(src);
+    const uint8_t* in_end = ip + len;
+    auto* out = reinterpret_cast<uint8_t*>(dst);
+    uint8_t* op = out;
+    uint8_t* out_end = out + out_len;
+    while (ip < in_end) {
+        uint8_t token = *ip++;
+        size_t literal_len = token >> 4;
+        if (literal_len == 15 && !detail::read_length(ip, in_end, literal_len)) {
+            return false;
+        }
+        if (literal_len > static_cast<size_t>(in_end - ip) ||
+            literal_len > static_cast<size_t>(out_end - op)) {
+            return false;
+        }
+        if (literal_len <= WILD_COPY && static_cast<size_t>(in_end - ip) >= WILD_COPY &&
+            static_cast<size_t>(out_end - op) >= WILD_COPY) {
+            std::memcpy(op, ip, WILD_COPY);
+        } else if (literal_len > 0) {
+            std::memcpy(op, ip, literal_len);
+        }
+        op += literal_len;
+        ip += literal_len;
+        if (ip == in_end) { // 最后一个序列只有字面量
+            break;
+        }
+        if (in_end - ip < 2) {
+            return false;
+        }
+        size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - out)) {
+            return false;
+        }
+        size_t match_len = token & 15;
+        if (match_len == 15 && !detail::read_length(ip, in_end, match_len)) {
+            return false;
+        }
+        match_len += MIN_MATCH;
+        if (match_len > static_cast<size_t>(out_end - op)) {
+            return false;
+        }
+        const uint8_t* match = op - offset;
+        if (offset >= WILD_COPY && static_cast<size_t>(out_end - op) >= match_len + WILD_COPY) {
+            // 每块读取的都是已经写好的数据
+            for (size_t copied = 0; copied < match_len; copied += WILD_COPY) {
+                std::memcpy(op + copied, match + copied, WILD_COPY);
+            }
+        } else {
+            // 源与目标可能重叠 (offset < match_len, 即重复的模式): 每次复制已输出的整数个周期,
+            // 复制长度逐次翻倍, 两段始终不重叠
+            for (size_t copied = 0; copied < match_len;) {
+                size_t chunk = std::min(match_len - copied, offset + copied);
+                std::memcpy(op + copied, match, chunk);
+                copied += chunk;
+            }
+        }
+        op += match_len;
+    }
+    return op == out_end;
+}
+} // namespace lz4
+} // namespace trpc
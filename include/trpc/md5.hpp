@@ -46,20 +46,20 @@ struct MD5CE {
     // Given the message length, calculates the padded message length. There has
     // to be room for the 1-byte end-of-message marker, plus 8 bytes for the
     // uint64_t encoded message length, all rounded up to a multiple of 64 bytes.
-    static uint32_t GetPaddedMessageLength(const uint32_t n) {
+    static constexpr uint32_t GetPaddedMessageLength(const uint32_t n) {
         return (((n + 1 + 8) + 63) / 64) * 64;
     }
     // Extracts the |i|th byte of a uint64_t, where |i == 0| extracts the least
     // significant byte. It is expected that 0 <= i < 8.
-    static uint8_t ExtractByte(const uint64_t value, const uint32_t i) {
+    static constexpr uint8_t ExtractByte(const uint64_t value, const uint32_t i) {
         //    DCHECK_LT(i, 8u);
         return static_cast<uint8_t>((value >> (i * 8)) & 0xff);
     }
     // Extracts the |i|th byte of a message of length |n|.
-    static uint8_t GetPaddedMessageByte(const char *data,
-                                        const uint32_t n,
-                                        const uint32_t m,
-                                        const uint32_t i) {
+    static constexpr uint8_t GetPaddedMessageByte(const char *data,
+                                                  const uint32_t n,
+                                                  const uint32_t m,
+                                                  const uint32_t i) {
         //    DCHECK_LT(i, m);
         //    DCHECK_LT(n, m);
         //    DCHECK_EQ(m % 64, 0u);
@@ -80,10 +80,10 @@ struct MD5CE {
     // Extracts the uint32_t starting at position |i| from the padded message
     // generate by the provided input |data| of length |n|. The bytes are treated
     // in little endian order.
-    static uint32_t GetPaddedMessageWord(const char *data,
-                                         const uint32_t n,
-                                         const uint32_t m,
-                                         const uint32_t i) {
+    static constexpr uint32_t GetPaddedMessageWord(const char *data,
+                                                   const uint32_t n,
+                                                   const uint32_t m,
+                                                   const uint32_t i) {
         //    DCHECK_EQ(i % 4, 0u);
         //    DCHECK_LT(i, m);
         //    DCHECK_LT(n, m);
@@ -95,10 +95,10 @@ struct MD5CE {
     }
     // Given an input buffer of length |n| bytes, extracts one round worth of data
     // starting at offset |i|.
-    static RoundData GetRoundData(const char *data,
-                                  const uint32_t n,
-                                  const uint32_t m,
-                                  const uint32_t i) {
+    static constexpr RoundData GetRoundData(const char *data,
+                                            const uint32_t n,
+                                            const uint32_t m,
+                                            const uint32_t i) {
         //    DCHECK_EQ(i % 64, 0u);
         //    DCHECK_LT(i, m);
         //    DCHECK_LT(n, m);
@@ -116,7 +116,10 @@ struct MD5CE {
     //////////////////////////////////////////////////////////////////////////////
     // HASH IMPLEMENTATION
     // Mixes elements |b|, |c| and |d| at round |i| of the calculation.
-    static uint32_t CalcF(const uint32_t i, const uint32_t b, const uint32_t c, const uint32_t d) {
+    static constexpr uint32_t CalcF(const uint32_t i,
+                                    const uint32_t b,
+                                    const uint32_t c,
+                                    const uint32_t d) {
         //    DCHECK_LT(i, 64u);
         if (i < 16) {
             return d ^ (b & (c ^ d));
@@ -128,11 +131,11 @@ struct MD5CE {
             return c ^ (b | (~d));
         }
     }
-    static uint32_t CalcF(const uint32_t i, const IntermediateData &intermediate) {
+    static constexpr uint32_t CalcF(const uint32_t i, const IntermediateData &intermediate) {
         return CalcF(i, intermediate.b, intermediate.c, intermediate.d);
     }
     // Calculates the indexing function at round |i|.
-    static uint32_t CalcG(const uint32_t i) {
+    static constexpr uint32_t CalcG(const uint32_t i) {
         //    DCHECK_LT(i, 64u);
         if (i < 16) {
             return i;
@@ -145,19 +148,19 @@ struct MD5CE {
         }
     }
     // Calculates the rotation to be applied at round |i|.
-    static uint32_t GetShift(const uint32_t i) {
+    static constexpr uint32_t GetShift(const uint32_t i) {
         //    DCHECK_LT(i, 64u);
         return kShifts[(i / 16) * 4 + (i % 4)];
     }
     // Rotates to the left the given |value| by the given |bits|.
-    static uint32_t LeftRotate(const uint32_t value, const uint32_t bits) {
+    static constexpr uint32_t LeftRotate(const uint32_t value, const uint32_t bits) {
         //    DCHECK_LT(bits, 32u);
         return (value << bits) | (value >> (32 - bits));
     }
     // Applies the ith step of mixing.
-    static IntermediateData ApplyStep(const uint32_t i,
-                                      const RoundData &data,
-                                      const IntermediateData &intermediate) {
+    static constexpr IntermediateData ApplyStep(const uint32_t i,
+                                                const RoundData &data,
+                                                const IntermediateData &intermediate) {
         //    DCHECK_LT(i, 64u);
         const uint32_t g = CalcG(i);
         //    DCHECK_LT(g, 16u);
@@ -169,14 +172,14 @@ struct MD5CE {
                                 /* d */ intermediate.c};
     }
     // Adds two IntermediateData together.
-    static IntermediateData Add(const IntermediateData &intermediate1,
-                                const IntermediateData &intermediate2) {
+    static constexpr IntermediateData Add(const IntermediateData &intermediate1,
+                                          const IntermediateData &intermediate2) {
         return IntermediateData{
             intermediate1.a + intermediate2.a, intermediate1.b + intermediate2.b,
             intermediate1.c + intermediate2.c, intermediate1.d + intermediate2.d};
     }
     // Processes an entire message.
-    static IntermediateData ProcessMessage(const char *message, const uint32_t n) {
+    static constexpr IntermediateData ProcessMessage(const char *message, const uint32_t n) {
         const uint32_t m = GetPaddedMessageLength(n);
         IntermediateData intermediate0 = kInitialIntermediateData;
         for (uint32_t offset = 0; offset < m; offset += 64) {
@@ -189,7 +192,7 @@ struct MD5CE {
     }
     //////////////////////////////////////////////////////////////////////////////
     // HELPER FUNCTIONS
-    static uint32_t StringLength(const char *string) {
+    static constexpr uint32_t StringLength(const char *string) {
         const char *end = string;
         while (*end != 0) ++end;
         // Double check that the precision losing conversion is safe.
@@ -199,27 +202,27 @@ struct MD5CE {
         //           (end - string));
         return static_cast<uint32_t>(end - string);
     }
-    static uint32_t SwapEndian(uint32_t a) {
+    static constexpr uint32_t SwapEndian(uint32_t a) {
         return ((a & 0xff) << 24) | (((a >> 8) & 0xff) << 16) | (((a >> 16) & 0xff) << 8) |
                ((a >> 24) & 0xff);
     }
     //////////////////////////////////////////////////////////////////////////////
     // WRAPPER FUNCTIONS
-    static uint64_t Hash64(const char *data, uint32_t n) {
+    static constexpr uint64_t Hash64(const char *data, uint32_t n) {
         IntermediateData intermediate = ProcessMessage(data, n);
         return (static_cast<uint64_t>(SwapEndian(intermediate.a)) << 32) |
                static_cast<uint64_t>(SwapEndian(intermediate.b));
     }
-    static uint32_t Hash32(const char *data, uint32_t n) {
+    static constexpr uint32_t Hash32(const char *data, uint32_t n) {
         IntermediateData intermediate = ProcessMessage(data, n);
         return SwapEndian(intermediate.a);
     }
 };
 // https://chromium.googlesource.com/chromium/src/base/+/refs/heads/main/hash/md5__internal.h
-inline uint32_t MD5Hash32(const char *string) {
+inline constexpr uint32_t MD5Hash32(const char *string) {
     return MD5CE::Hash32(string, MD5CE::StringLength(string));
 }
-inline uint32_t MD5Hash32(const char *string, uint32_t length) {
+inline constexpr uint32_t MD5Hash32(const char *string, uint32_t length) {
     return MD5CE::Hash32(string, length);
 }
 
@@ -13,12 +13,62 @@ struct RpcHeader {
     uint64_t request_id;
     uint32_t body_len;
     uint32_t function_id;
+    // 请求: 相对于服务端收到该帧时的超时时间 (毫秒), 0 表示不限; 响应中为 0
+    uint32_t timeout_ms;
+    // 低 2 位为 body 的编码方式 (CodecType), 之后是 COMPRESSED_FLAG 等标志, 其余保留为 0
+    uint32_t flags;
 };
 
-struct RpcMsg {
-    RpcHeader header;
-    std::string content;
+static constexpr size_t RPC_HEAD_LEN = sizeof(RpcHeader);
+
+// 请求参数与结果的编码方式, 见 codec.hpp。响应使用服务端实际采用的编码
+enum class CodecType : uint32_t {
+    MSGPACK = 0,
+    RAW = 1,
 };
 
-static constexpr size_t RPC_HEAD_LEN = sizeof(RpcHeader);
+static constexpr uint32_t CODEC_FLAG_MASK = 0x3;
+
+inline CodecType codec_of(const RpcHeader& header) {
+    return static_cast<CodecType>(header.flags & CODEC_FLAG_MASK);
+}
+
+// body 经过压缩, 格式见 compression.hpp
+static constexpr uint32_t COMPRESSED_FLAG = 0x4;
+// 只用于请求: 发送方能够解压, 服务端可以压缩该请求的响应
+static constexpr uint32_t ACCEPT_COMPRESSED_FLAG = 0x8;
+
+// 流式调用: 一个流的所有帧共用打开它的请求的 request_id。
+// 客户端发出带 STREAM_FLAG 的请求打开流, 随后以 credit 帧 (body 为 u32 小端条目数) 授予服务端
+// 可以发送的条目数; 服务端的每个响应帧 body 为 (OK, [条目...]), 最后一帧带 STREAM_END_FLAG,
+// body 为最终状态 (OK) 或 (FAIL, 原因)。客户端可以发送 cancel 帧提前结束, 之后不再收到响应
+static constexpr uint32_t STREAM_FLAG = 0x10;
+static constexpr uint32_t STREAM_END_FLAG = 0x20;
+static constexpr uint32_t STREAM_CREDIT_FLAG = 0x40;
+static constexpr uint32_t STREAM_CANCEL_FLAG = 0x80;
+
+// body 中的 u32 长度、credit 等按小端序编码
+inline void store_u32_le(char* p, uint32_t v) {
+    for (size_t i = 0; i < sizeof(v); ++i) {
+        p[i] = static_cast<char>(v >> (8 * i));
+    }
+}
+
+inline uint32_t load_u32_le(const char* p) {
+    uint32_t v = 0;
+    for (size_t i = 0; i < sizeof(v); ++i) {
+        v |= static_cast<uint32_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    }
+    return v;
+}
+
+// 调用结果的状态: code 为 FAIL 时 message 是失败原因 (服务端返回的错误、本地超时或解码失败),
+// 可能指向 RpcResult 内部, 不要在 RpcResult 销毁后使用
+struct ResultStatus {
+    FuncResultCode code{FuncResultCode::OK};
+    std::string_view message;
+
+    bool ok() const { return code == FuncResultCode::OK; }
+    explicit operator bool() const { return ok(); }
+};
 } // namespace trpc
@@ -1,8 +1,12 @@
 #pragma once
 
 #include <functional>
+#include <string_view>
 #include <tuple>
 #include <type_traits>
+#if __has_include(<span>)
+#include <span>
+#endif
 
 namespace trpc {
 template <typename T>
@@ -45,4 +49,32 @@ struct FunctionTraits<Ret (Class::*)(Args...) const> : FunctionTraits<Ret(Args..
 template <typename Callable>
 struct FunctionTraits : FunctionTraits<decltype(&Callable::operator())> {};
 
+// 去掉 tuple 的第一个元素类型, 用于异步 handler 的首个 Responder 参数
+template <typename Tuple>
+struct RemoveFirst;
+
+template <typename First, typename... Rest>
+struct RemoveFirst<std::tuple<First, Rest...>> {
+    using type = std::tuple<Rest...>;
+};
+
+// 引用外部内存的参数类型 (std::string_view, C++20 的 std::span),
+// 只在同步 handler 调用期间有效, 异步 handler 不能使用
+template <typename T>
+struct IsBorrowed : std::false_type {};
+
+template <>
+struct IsBorrowed<std::string_view> : std::true_type {};
+
+#if defined(__cpp_lib_span)
+template <typename T, size_t N>
+struct IsBorrowed<std::span<T, N>> : std::true_type {};
+#endif
+
+template <typename Tuple>
+struct HasBorrowed;
+
+template <typename... Args>
+struct HasBorrowed<std::tuple<Args...>> : std::disjunction<IsBorrowed<Args>...> {};
+
 } // namespace trpc
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+
+#include "asio/detail/noncopyable.hpp"
+
+namespace trpc {
+// 固定容量的待完成请求表, 以请求 id 的低位作为槽位下标。
+// 每个槽位的 tag 记录占用它的完整 id, 插入和取出都只对该槽位做一次 CAS, 不需要全局锁;
+// 过期或重复的响应因 tag 不匹配被拒绝。值只在插入时构造、取出时析构, 空槽位不持有 T
+template <typename T>
+class PendingTable : asio::noncopyable {
+public:
+    // capacity 向上取整为 2 的幂
+    explicit PendingTable(size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        slots_ = std::make_unique<Slot[]>(size);
+        mask_ = size - 1;
+    }
+
+    // 析构时不能再有并发的 insert/take
+    ~PendingTable() {
+        for (size_t i = 0; i <= mask_; ++i) {
+            if (slots_[i].tag.load(std::memory_order_relaxed) != FREE) {
+                slots_[i].value()->~T();
+            }
+        }
+    }
+
+    // 分配新的请求 id 并保存 value; 槽位全部被占用时返回 false, value 保持不变
+    bool insert(T& value, uint64_t& id) {
+        for (size_t attempt = 0; attempt <= mask_; ++attempt) {
+            id = next_id_.fetch_add(1, std::memory_order_relaxed);
+            Slot& slot = slots_[id & mask_];
+            uint64_t expected = FREE;
+            // 槽位仍被更早的请求占用时跳过这个 id
+            if (slot.tag.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire)) {
+                new (slot.storage) T(std::move(value));
+                slot.tag.store(id, std::memory_order_release);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // 取出 id 对应的值; id 不存在 (已完成、已超时或未知) 时返回 false
+    bool take(uint64_t id, T& value) {
+        if (id == FREE || id == LOCKED) { // 对端发来的任意 id 都可能到达这里
+            return false;
+        }
+        Slot& slot = slots_[id & mask_];
+        uint64_t expected = id;
+        if (!slot.tag.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire)) {
+            return false;
+        }
+        T* stored = slot.value();
+        value = std::move(*stored);
+        stored->~T();
+        slot.tag.store(FREE, std::memory_order_release);
+        return true;
+    }
+
+    // 取出表中所有的值, 依次调用 f(id, T&&); 与并发的 take 互斥, 每个值只会被其中一方取出
+    template <typename F>
+    void drain(F f) {
+        for (size_t i = 0; i <= mask_; ++i) {
+            Slot& slot = slots_[i];
+            uint64_t id = slot.tag.load(std::memory_order_relaxed);
+            if (id == FREE || id == LOCKED ||
+                !slot.tag.compare_exchange_strong(id, LOCKED, std::memory_order_acquire)) {
+                continue;
+            }
+            T* stored = slot.value();
+            T value = std::move(*stored);
+            stored->~T();
+            slot.tag.store(FREE, std::memory_order_release);
+            f(id, std::move(value));
+        }
+    }
+
+    // id 是否仍在表中 (尚未取出); 只是某一时刻的快照
+    bool contains(uint64_t id) const {
+        return id != FREE && id != LOCKED &&
+               slots_[id & mask_].tag.load(std::memory_order_acquire) == id;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    // 请求 id 从 1 开始递增, 不会与这两个值冲突
+    static constexpr uint64_t FREE = 0;
+    static constexpr uint64_t LOCKED = UINT64_MAX;
+
+    struct Slot {
+        std::atomic<uint64_t> tag{FREE};
+        alignas(T) unsigned char storage[sizeof(T)]; // tag 为请求 id 时存放一个 T
+
+        T* value() { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t mask_{0};
+    std::atomic<uint64_t> next_id_{1};
+};
+} // namespace trpc
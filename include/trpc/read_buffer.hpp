@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstring>
+#include <string_view>
+
+#include "asio.hpp"
+#include "trpc/buffer.hpp"
+#include "trpc/message.h"
+
+namespace trpc {
+// 读缓冲区: 每次 async_read_some 尽量填满空闲区域，之后逐个取出其中已完整的帧。
+// 不完整的帧留在原处，只有当尾部空间放不下它时才搬移到开头或扩容。
+class ReadBuffer {
+public:
+    explicit ReadBuffer(size_t capacity)
+        : default_capacity_(capacity) {
+        data_.resize(capacity);
+    }
+
+    // 供 async_read_some 写入的空闲区域
+    asio::mutable_buffer prepare() {
+        return asio::buffer(data_.data() + end_, data_.size() - end_);
+    }
+
+    void commit(size_t len) { end_ += len; }
+
+    // 取出下一个完整的帧; body 指向缓冲区内部，在下一次 prepare() 之前有效
+    bool next_frame(RpcHeader& header, std::string_view& body) {
+        if (end_ - begin_ < RPC_HEAD_LEN) {
+            return false;
+        }
+        std::memcpy(&header, data_.data() + begin_, RPC_HEAD_LEN);
+        if (end_ - begin_ - RPC_HEAD_LEN < header.body_len) {
+            return false;
+        }
+        body = std::string_view(data_.data() + begin_ + RPC_HEAD_LEN, header.body_len);
+        begin_ += RPC_HEAD_LEN + header.body_len;
+        return true;
+    }
+
+    // body 为刚取出的最后一帧且占了为它扩容的缓冲区的大半时, 把整个缓冲区交给 out,
+    // 省去大帧的拷贝 (body 仍指向其中); 自身换用默认容量的新缓冲区
+    bool release_frame(std::string_view body, Buffer& out) {
+        if (begin_ != end_ || data_.size() <= default_capacity_ || body.size() * 2 < data_.size()) {
+            return false;
+        }
+        out = std::move(data_);
+        data_ = Buffer();
+        data_.resize(default_capacity_);
+        begin_ = end_ = 0;
+        return true;
+    }
+
+    // 在发起下一次读之前调用，为剩余的不完整帧准备足够的空间
+    void reserve_for_next() {
+        if (begin_ == end_) {
+            begin_ = end_ = 0;
+            if (data_.size() > MAX_RETAINED_BUFFER_SIZE) {
+                // 大帧处理完后恢复默认容量
+                data_ = Buffer();
+                data_.resize(default_capacity_);
+            }
+            return;
+        }
+        size_t need = RPC_HEAD_LEN;
+        if (end_ - begin_ >= RPC_HEAD_LEN) {
+            RpcHeader header;
+            std::memcpy(&header, data_.data() + begin_, RPC_HEAD_LEN);
+            need += header.body_len;
+        }
+        if (data_.size() - begin_ >= need) {
+            return; // 尾部空间足够，无需搬移
+        }
+        size_t remain = end_ - begin_;
+        if (data_.size() >= need) {
+            std::memmove(data_.data(), data_.data() + begin_, remain);
+        } else {
+            Buffer bigger(need);
+            bigger.write(data_.data() + begin_, remain);
+            bigger.resize(need);
+            data_ = std::move(bigger);
+        }
+        begin_ = 0;
+        end_ = remain;
+    }
+
+private:
+    Buffer data_; // data_.size() 即容量
+    size_t begin_{0};
+    size_t end_{0};
+    size_t default_capacity_;
+};
+} // namespace trpc
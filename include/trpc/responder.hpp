@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <utility>
+
+#include "asio.hpp"
+#include "clog/clog.h"
+#include "trpc/buffer.hpp"
+#include "trpc/codec.hpp"
+#include "trpc/message.h"
+
+namespace trpc {
+// 响应帧的写出端，由 Connection 实现; send_response 可在任意线程调用,
+// request 为该响应对应的请求帧头, 用于决定是否压缩
+class ResponseSink {
+public:
+    virtual ~ResponseSink() = default;
+    virtual void send_response(Buffer frame, const RpcHeader& request) = 0;
+    // 所属连接的 io_context
+    virtual asio::any_io_executor get_executor() = 0;
+};
+
+// frame 的前 RPC_HEAD_LEN 字节为预留的帧头，body 编码完成后填入; flags 为编码方式之外的标志
+inline void write_response_header(Buffer& frame,
+                                  const RpcHeader& request,
+                                  CodecType codec = CodecType::MSGPACK,
+                                  uint32_t flags = 0) {
+    RpcHeader header{request.request_id, static_cast<uint32_t>(frame.size() - RPC_HEAD_LEN),
+                     request.function_id, 0, static_cast<uint32_t>(codec) | flags};
+    std::memcpy(frame.data(), &header, RPC_HEAD_LEN);
+}
+
+// 异步 handler 的应答对象，只能移动。可以保存下来在任意线程调用一次 done/fail,
+// 响应会以原请求的 request_id 写回所属连接。销毁前仍未应答时自动返回 FAIL, 避免客户端一直等待。
+class Responder {
+public:
+    Responder() = default;
+    Responder(std::shared_ptr<ResponseSink> sink, const RpcHeader& request)
+        : sink_(std::move(sink)),
+          request_(request) {}
+
+    Responder(Responder&&) noexcept = default;
+    Responder& operator=(Responder&& other) noexcept {
+        if (this != &other) {
+            drop();
+            sink_ = std::move(other.sink_);
+            request_ = other.request_;
+        }
+        return *this;
+    }
+
+    ~Responder() { drop(); }
+
+    // 返回结果, 无返回值的函数调用 done()
+    template <typename... T>
+    void done(const T&... value) {
+        static_assert(sizeof...(T) <= 1, "done() takes at most one result");
+        send(FuncResultCode::OK, value...);
+    }
+
+    void fail(std::string_view message) { send(FuncResultCode::FAIL, message); }
+
+    // 尚未应答
+    bool pending() const { return sink_ != nullptr; }
+
+    // 所属连接的 executor, 需在应答之前调用
+    asio::any_io_executor get_executor() const { return sink_->get_executor(); }
+
+private:
+    template <typename... Args>
+    void send(const Args&... args) {
+        if (sink_ == nullptr) {
+            CLOG_WARN("request {} already responded", request_.request_id);
+            return;
+        }
+        Buffer frame(msgpack_codec::init_size);
+        frame.resize(RPC_HEAD_LEN);
+        msgpack_codec::pack_args_to(frame, args...);
+        if (frame.size() - RPC_HEAD_LEN > UINT32_MAX) {
+            frame.resize(RPC_HEAD_LEN);
+            msgpack_codec::pack_args_to(frame, FuncResultCode::FAIL, "result too long");
+        }
+        write_response_header(frame, request_);
+        std::exchange(sink_, nullptr)->send_response(std::move(frame), request_);
+    }
+
+    void drop() {
+        if (sink_ != nullptr) {
+            fail("request dropped by handler");
+        }
+    }
+
+    std::shared_ptr<ResponseSink> sink_;
+    RpcHeader request_{};
+};
+} // namespace trpc
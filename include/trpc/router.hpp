@@ -2,110 +2,414 @@
 
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <string_view>
+#include <tuple>
 #include <unordered_map>
+#include <vector>
 
 #include "asio.hpp"
 #include "trpc/codec.hpp"
-#include "trpc/md5.hpp"
+#include "trpc/compression.hpp"
+#include "trpc/func_id.hpp"
 #include "trpc/meta_util.hpp"
+#include "trpc/responder.hpp"
+#include "trpc/worker_pool.hpp"
 
 namespace trpc {
 
+// 注册阶段使用 unordered_map; freeze() 之后不再允许注册, 查找改用紧凑的开放寻址表。
+// 不同函数名的 id (MD5 前 4 字节) 冲突时注册直接抛出异常, 而不是覆盖已有的 handler。
+// 同步 handler 的参数可以声明为 std::string_view (C++20 还可以是 std::span<const char>),
+// 直接指向请求所在的接收缓冲区, 只在本次调用期间有效。
+// 请求按帧头中的 CodecType 解码; 参数与返回值都可平凡拷贝的同步 handler 同时支持 RawCodec。
 class Router : public asio::noncopyable {
 public:
+    using buffer_type = msgpack_codec::buffer_type;
+
     template <typename F>
     void register_handler(const std::string& name, F f) {
-        uint32_t key = MD5::MD5Hash32(name.data());
-        func_name_map_.emplace(key, name);
-        func_map_[key] = [f](std::string_view str) -> std::string {
-            using args_tuple = typename FunctionTraits<F>::bare_params_type;
-            msgpack::object_handle handle; // 该对象保存了 unpack 的结果，销毁时会使结果销毁
-            try {
-                auto params = msgpack_codec::unpack<args_tuple>(handle, str.data(), str.size());
-                return call(f, std::move(params));
-            } catch (const std::exception& e) {
-                return msgpack_codec::pack_args_to_str(FuncResultCode::FAIL, e.what());
-            }
-        };
+        using args_tuple = typename FunctionTraits<F>::bare_params_type;
+        set_func<args_tuple>(add_handler(name), [f](args_tuple&& params) {
+            return std::apply(f, std::move(params));
+        });
     }
 
     template <typename F, typename Self>
     void register_handler(const std::string& name, F f, Self* self) {
-        uint32_t key = MD5::MD5Hash32(name.data());
-        func_name_map_.emplace(key, name);
-        func_map_[key] = [f, self](std::string_view str) -> std::string {
-            using args_tuple = typename FunctionTraits<F>::bare_params_type;
-            msgpack::object_handle handle; // 该对象保存了 unpack 的结果，销毁时会使结果销毁
+        using args_tuple = typename FunctionTraits<F>::bare_params_type;
+        set_func<args_tuple>(add_handler(name), [f, self](args_tuple&& params) {
+            return std::apply(
+                [f, self](auto&&... args) {
+                    return (self->*f)(std::forward<decltype(args)>(args)...);
+                },
+                std::move(params));
+        });
+    }
+
+    // 异步 handler: 第一个参数为 Responder, 其余为调用参数, 返回值被忽略。
+    // handler 可以保存 Responder 并在之后的任意线程中应答, 不占用 io 线程。
+    template <typename F>
+    void register_async_handler(const std::string& name, F f) {
+        set_async_func(add_handler(name), make_async_func<async_args_type<F>>(f));
+    }
+
+    template <typename F, typename Self>
+    void register_async_handler(const std::string& name, F f, Self* self) {
+        auto call = [f, self](Responder responder, auto&&... args) {
+            (self->*f)(std::move(responder), std::forward<decltype(args)>(args)...);
+        };
+        set_async_func(add_handler(name), make_async_func<async_args_type<F>>(call));
+    }
+
+    // 流式 handler: f(args...) 返回生成器 next, 每次调用 next() 得到下一个条目 std::optional<T>,
+    // 返回空表示结束, 抛出异常表示失败。生成器在连接的 io 线程中按客户端授予的 credit 逐个调用,
+    // 不能阻塞; 它比请求缓冲区活得更久, 参数不能是借用类型, 且需可拷贝 (保存在 std::function 中)
+    template <typename F>
+    void register_stream_handler(const std::string& name, F f) {
+        using args_tuple = typename FunctionTraits<F>::bare_params_type;
+        static_assert(!HasBorrowed<args_tuple>::value,
+                      "stream handlers outlive the request buffer, use owning parameter types");
+        set_stream_func(add_handler(name), [f](std::string_view str) -> Handler::StreamNext {
+            auto& zone = thread_zone();
+            args_tuple params;
             try {
-                auto params = msgpack_codec::unpack<args_tuple>(handle, str.data(), str.size());
-                return call_member(f, self, std::move(params));
-            } catch (const std::exception& e) {
-                return msgpack_codec::pack_args_to_str(FuncResultCode::FAIL, e.what());
+                params = msgpack_codec::unpack<args_tuple>(zone, str.data(), str.size());
+                zone.clear();
+            } catch (...) {
+                zone.clear();
+                throw;
             }
+            return [next = std::apply(f, std::move(params))](buffer_type& out) mutable {
+                auto item = next();
+                if (!item) {
+                    return false;
+                }
+                msgpack::packer<buffer_type>(out).pack(*item);
+                return true;
+            };
+        });
+    }
+
+#if defined(ASIO_HAS_CO_AWAIT)
+    // 协程 handler (C++20): f(Args...) 返回 asio::awaitable<R>, 在连接所在的 io_context 上运行,
+    // 可以 co_await 其他异步操作 (例如 RpcClient::co_call), co_return 的结果即为响应
+    template <typename F>
+    void register_coro_handler(const std::string& name, F f) {
+        auto call = [f](Responder responder, auto&&... args) {
+            auto executor = responder.get_executor();
+            asio::co_spawn(executor, run_coro(f, std::move(responder), std::move(args)...),
+                           asio::detached);
         };
+        set_async_func(add_handler(name),
+                       make_async_func<typename FunctionTraits<F>::bare_params_type>(call));
     }
+#endif
 
-    // 根据 key 找到相应函数并调用
-    std::string route(uint32_t key, std::string_view args) {
-        std::string result;
-        auto it = func_map_.find(key);
+    // 指定 handler 在哪个 WorkerPool 中执行, nullptr 表示直接在 io 线程中执行
+    void set_executor(const std::string& name, WorkerPool* executor) {
+        if (frozen_) {
+            throw std::logic_error("set_executor: router is frozen");
+        }
+        auto it = func_map_.find(func_id(name).value);
         if (it == func_map_.end()) {
-            result = msgpack_codec::pack_args_to_str(FuncResultCode::FAIL, "unknown function");
-        } else {
-            result = it->second(args);
+            throw std::invalid_argument("set_executor: unknown function " + name);
+        }
+        it->second.executor = executor;
+    }
+
+    // 单独指定 handler 的响应是否压缩 (请求方支持解压时), 覆盖服务端的默认设置
+    void set_compression(const std::string& name, Compression compression) {
+        if (frozen_) {
+            throw std::logic_error("set_compression: router is frozen");
+        }
+        auto it = func_map_.find(func_id(name).value);
+        if (it == func_map_.end()) {
+            throw std::invalid_argument("set_compression: unknown function " + name);
+        }
+        it->second.compression = compression;
+    }
+
+    struct Handler;
+
+    // 查找与调用时用到的字段。freeze() 后查找表的槽直接保存一份, 同步调用只需读一个槽;
+    // 同步 handler 为函数指针 + 状态 (指向保存在 Handler::state_owner 中的可调用对象),
+    // 调用时无需经过 std::function。参数与返回值都能用 RawCodec 编码的另有 raw_func, 两者共用 state
+    struct Entry {
+        using SyncFunc = void (*)(const void* state,
+                                  std::string_view args,
+                                  buffer_type& out,
+                                  msgpack::zone& zone);
+        enum class Kind : uint8_t { SYNC, ASYNC, STREAM };
+
+        SyncFunc func{nullptr};
+        SyncFunc raw_func{nullptr};
+        const void* state{nullptr};
+        WorkerPool* executor{nullptr};
+        const Handler* owner{nullptr}; // 异步与流式 handler 的 std::function 在其中; 空槽为 nullptr
+        uint32_t key{0};
+        Kind kind{Kind::SYNC};
+        Compression compression{Compression::DEFAULT};
+
+        // 处理以 codec 编码的请求的同步函数, 不支持该编码时为空
+        SyncFunc sync_func(CodecType codec) const {
+            switch (codec) {
+            case CodecType::MSGPACK:
+                return func;
+            case CodecType::RAW:
+                return raw_func;
+            }
+            return nullptr;
+        }
+
+        // 异步 handler 只接受 msgpack 编码的请求, 其余交给 invoke() 返回错误
+        bool is_async(CodecType codec) const {
+            return kind == Kind::ASYNC && codec == CodecType::MSGPACK;
+        }
+    };
+
+    // 注册的 handler, 保存在 unordered_map 的节点中, 地址在注册后不变。
+    // 异步与流式 handler 使用 std::function, 由 kind 区分, 只设置其一
+    struct Handler : Entry {
+        // 把下一个条目编码追加到 out 末尾, 没有更多条目时返回 false
+        using StreamNext = std::function<bool(buffer_type& out)>;
+        std::function<void(std::string_view, Responder)> async_func;
+        // 解码 (msgpack 编码的) 参数并创建生成器, 失败时抛出异常
+        std::function<StreamNext(std::string_view)> stream_func;
+        std::shared_ptr<const void> state_owner;
+    };
+
+    // 注册完成后调用: 检查并生成只读的查找表, 之后不能再注册或修改 handler。
+    // 表的容量为 2 的幂且至少为 handler 数的两倍, 以 id 的低位定位, 线性探测;
+    // 每个槽是 handler 的 Entry 副本 (48 字节), 查找和同步调用通常只需读一个槽
+    void freeze() {
+        if (frozen_) {
+            return;
+        }
+        size_t capacity = 1;
+        while (capacity < func_map_.size() * 2) {
+            capacity *= 2;
         }
-        if (result.size() > UINT32_MAX) {
-            result = msgpack_codec::pack_args_to_str(FuncResultCode::FAIL, "result too long");
+        table_.assign(capacity, Entry{});
+        mask_ = static_cast<uint32_t>(capacity - 1);
+        for (auto& [key, handler] : func_map_) {
+            uint32_t i = key & mask_;
+            while (table_[i].owner != nullptr) {
+                i = (i + 1) & mask_;
+            }
+            table_[i] = handler;
         }
-        return result;
+        frozen_ = true;
+    }
+
+    bool frozen() const { return frozen_; }
+
+    // 注册完成后返回的指针保持有效
+    const Entry* find(uint32_t key) const {
+        if (frozen_) {
+            for (uint32_t i = key & mask_;; i = (i + 1) & mask_) {
+                const Entry& slot = table_[i];
+                if (slot.owner == nullptr) {
+                    return nullptr;
+                }
+                if (slot.key == key) {
+                    return &slot;
+                }
+            }
+        }
+        auto it = func_map_.find(key);
+        return it == func_map_.end() ? nullptr : &it->second;
+    }
+
+    // 调用 handler (为空表示未知函数), 结果按请求的编码方式直接追加编码到 out 末尾。
+    // 返回结果实际使用的编码: 未知函数、handler 不支持该编码或结果过长时以 msgpack 返回 FAIL
+    static CodecType invoke(const Entry* handler,
+                            CodecType codec,
+                            std::string_view args,
+                            buffer_type& out) {
+        size_t start = out.size();
+        if (handler == nullptr) {
+            msgpack_codec::pack_args_to(out, FuncResultCode::FAIL, "unknown function");
+            return CodecType::MSGPACK;
+        }
+        if (handler->kind == Entry::Kind::STREAM) {
+            msgpack_codec::pack_args_to(out, FuncResultCode::FAIL, "stream function");
+            return CodecType::MSGPACK;
+        }
+        Entry::SyncFunc func = handler->sync_func(codec);
+        if (func == nullptr) {
+            msgpack_codec::pack_args_to(out, FuncResultCode::FAIL, "codec not supported");
+            return CodecType::MSGPACK;
+        }
+        auto& zone = thread_zone();
+        func(handler->state, args, out, zone);
+        zone.clear();
+        if (out.size() - start > UINT32_MAX) {
+            out.resize(start);
+            msgpack_codec::pack_args_to(out, FuncResultCode::FAIL, "result too long");
+            return CodecType::MSGPACK;
+        }
+        return codec;
+    }
+
+    // 根据 key 找到相应函数并调用
+    CodecType route(uint32_t key,
+                    std::string_view args,
+                    buffer_type& out,
+                    CodecType codec = CodecType::MSGPACK) const {
+        return invoke(find(key), codec, args, out);
     }
 
 private:
-    using RpcFunc = std::function<std::string(std::string_view)>;
-    using FuncMap = std::unordered_map<uint32_t, RpcFunc>;
+    using FuncMap = std::unordered_map<uint32_t, Handler>;
     using FuncNameMap = std::unordered_map<uint32_t, std::string>;
 
-    template <typename F, typename... Args>
-    static std::string call(const F& f, std::tuple<Args...> tp) {
-        return call_helper(f, std::make_index_sequence<sizeof...(Args)>{}, std::move(tp));
+    // 同名重复注册时覆盖原有的 handler
+    Handler& add_handler(const std::string& name) {
+        if (frozen_) {
+            throw std::logic_error("register " + name + ": router is frozen");
+        }
+        uint32_t key = func_id(name).value;
+        auto [it, inserted] = func_name_map_.emplace(key, name);
+        if (!inserted && it->second != name) {
+            throw std::invalid_argument("function id collision: " + it->second + " and " + name);
+        }
+        Handler& handler = func_map_[key];
+        handler.owner = &handler;
+        handler.key = key;
+        return handler;
     }
 
-    template <typename F, size_t... I, typename... Args>
-    static std::string call_helper(const F& f,
-                                   const std::index_sequence<I...>&,
-                                   std::tuple<Args...> tp) {
-        if constexpr (std::is_same_v<std::result_of_t<F(Args...)>, void>) {
-            f(std::move(std::get<I>(tp))...);
-            return msgpack_codec::pack_args_to_str(FuncResultCode::OK);
+    // apply(args_tuple&&) 调用用户函数。每种编码生成一个解码、调用、编码结果的函数
+    template <typename args_tuple, typename Apply>
+    static void set_func(Handler& handler, Apply apply) {
+        using result_type = std::invoke_result_t<const Apply&, args_tuple&&>;
+        auto state = std::make_shared<const Apply>(std::move(apply));
+        handler.func = &call_with<MsgpackCodec, args_tuple, Apply>;
+        if constexpr (CodecAccepts<RawCodec, args_tuple>::value &&
+                      RawCodec::accepts<result_type>) {
+            handler.raw_func = &call_with<RawCodec, args_tuple, Apply>;
         } else {
-            auto res = f(std::move(std::get<I>(tp))...);
-            return msgpack_codec::pack_args_to_str(FuncResultCode::OK, res);
+            handler.raw_func = nullptr;
         }
+        handler.state = state.get();
+        handler.state_owner = std::move(state);
+        handler.kind = Entry::Kind::SYNC;
+        handler.async_func = nullptr;
+        handler.stream_func = nullptr;
     }
 
-    template <typename F, typename Self, typename... Args>
-    static std::string call_member(const F& f, Self* self, std::tuple<Args...> tp) {
-        return call_member_helper(f, self, std::make_index_sequence<sizeof...(Args)>{},
-                                  std::move(tp));
+    template <typename Codec, typename args_tuple, typename Apply>
+    static void call_with(const void* state,
+                          std::string_view args,
+                          buffer_type& out,
+                          msgpack::zone& zone) {
+        const Apply& apply = *static_cast<const Apply*>(state);
+        size_t start = out.size();
+        try {
+            auto params = Codec::template unpack_args<args_tuple>(zone, args);
+            if constexpr (std::is_void_v<std::invoke_result_t<const Apply&, args_tuple&&>>) {
+                apply(std::move(params));
+                Codec::pack_ok(out);
+            } else {
+                Codec::pack_ok(out, apply(std::move(params)));
+            }
+        } catch (const std::exception& e) {
+            out.resize(start);
+            Codec::pack_fail(out, e.what());
+        }
     }
 
-    template <typename F, typename Self, size_t... I, typename... Args>
-    static std::string call_member_helper(const F& f,
-                                          Self* self,
-                                          std::index_sequence<I...>,
-                                          std::tuple<Args...> tp) {
-        if constexpr (std::is_same_v<std::result_of_t<F(Self*, Args...)>, void>) {
-            (self->*f)(std::move(std::get<I>(tp))...);
-            return msgpack_codec::pack_args_to_str(FuncResultCode::OK);
-        } else {
-            auto res = (self->*f)(std::move(std::get<I>(tp))...);
-            return msgpack_codec::pack_args_to_str(FuncResultCode::OK, res);
+    static void set_async_func(Handler& handler,
+                               std::function<void(std::string_view, Responder)> async_func) {
+        handler.func = nullptr;
+        handler.raw_func = nullptr;
+        handler.state = nullptr;
+        handler.state_owner.reset();
+        handler.kind = Entry::Kind::ASYNC;
+        handler.async_func = std::move(async_func);
+        handler.stream_func = nullptr;
+    }
+
+    static void set_stream_func(Handler& handler,
+                                std::function<Handler::StreamNext(std::string_view)> stream_func) {
+        handler.func = nullptr;
+        handler.raw_func = nullptr;
+        handler.state = nullptr;
+        handler.state_owner.reset();
+        handler.kind = Entry::Kind::STREAM;
+        handler.async_func = nullptr;
+        handler.stream_func = std::move(stream_func);
+    }
+
+    // 异步 handler 的调用参数 (去掉第一个 Responder 参数)
+    template <typename F>
+    using async_args_type =
+        typename RemoveFirst<typename FunctionTraits<F>::bare_params_type>::type;
+
+    // 解码用的 zone, 每个线程一个, 每次调用后 clear() 复用, 避免每个请求重新分配。
+    // handler 都在调用线程中同步执行, 因此不需要按连接区分
+    static msgpack::zone& thread_zone() {
+        static thread_local msgpack::zone zone;
+        return zone;
+    }
+
+    // 解包得到 args_tuple 后调用 call(Responder, args...)
+    template <typename args_tuple, typename Call>
+    static std::function<void(std::string_view, Responder)> make_async_func(Call call) {
+        static_assert(!HasBorrowed<args_tuple>::value,
+                      "async handlers may outlive the request buffer, use owning parameter types");
+        return [call](std::string_view str, Responder responder) {
+            auto& zone = thread_zone();
+            args_tuple params;
+            try {
+                params = msgpack_codec::unpack<args_tuple>(zone, str.data(), str.size());
+                zone.clear();
+            } catch (const std::exception& e) {
+                zone.clear();
+                responder.fail(e.what());
+                return;
+            }
+            try {
+                std::apply(
+                    [&call, &responder](auto&&... args) {
+                        call(std::move(responder), std::forward<decltype(args)>(args)...);
+                    },
+                    std::move(params));
+            } catch (const std::exception& e) {
+                // 已移入 handler 的 Responder 在析构时会返回 FAIL
+                if (responder.pending()) {
+                    responder.fail(e.what());
+                }
+            }
+        };
+    }
+
+#if defined(ASIO_HAS_CO_AWAIT)
+    // 参数按值保存在协程帧中
+    template <typename F, typename... Args>
+    static asio::awaitable<void> run_coro(F f, Responder responder, Args... args) {
+        using result_type = typename FunctionTraits<F>::return_type::value_type;
+        try {
+            if constexpr (std::is_void_v<result_type>) {
+                co_await f(std::move(args)...);
+                responder.done();
+            } else {
+                auto res = co_await f(std::move(args)...);
+                responder.done(res);
+            }
+        } catch (const std::exception& e) {
+            responder.fail(e.what());
         }
     }
+#endif
 
     FuncMap func_map_;
     FuncNameMap func_name_map_;
+    bool frozen_{false};
+    std::vector<Entry> table_; // freeze() 生成的查找表
+    uint32_t mask_{0};
 };
 } // namespace trpc
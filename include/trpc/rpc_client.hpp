@@ -1,34 +1,82 @@
 #pragma once
+#include <algorithm>
+#include <chrono>
 #include <condition_variable>
-#include <deque>
+#include <cstring>
+#include <functional>
 #include <future>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <stdexcept>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
 
 #include "asio.hpp"
-#include "trpc/md5.hpp"
+#include "clog/clog.h"
+#include "trpc/compression.hpp"
+#include "trpc/func_id.hpp"
+#include "trpc/meta_util.hpp"
+#include "trpc/pending_table.hpp"
+#include "trpc/read_buffer.hpp"
 #include "trpc/rpc_result.hpp"
+#include "trpc/rpc_stream.hpp"
+#include "trpc/stats.hpp"
+#include "trpc/write_queue.hpp"
 
 namespace trpc {
 static constexpr int DEFAULT_TIMEOUT = 5;
+// 每个连接同时未完成的调用数上限, 超过时 async_call 抛出 std::runtime_error。
+// 待完成表在构造时按上限一次分配, 每个槽位约 72 字节: 默认 1024 个约 72 KB,
+// RpcClientPool 的每个连接各一份; 需要更深的流水线时在构造时调大
+static constexpr size_t DEFAULT_MAX_PENDING_CALLS = 1024;
+
+// 一个未完成的调用: 回调版本只有 callback, future 版本只有 promise (其共享状态在发起调用时分配)
+struct PendingCall {
+    std::function<void(RpcResult)> callback;
+    std::optional<std::promise<RpcResult>> promise;
+};
 
 class RpcClient : asio::noncopyable {
 public:
-    RpcClient(std::string host, unsigned short port)
+    // 独立模式: 自带 io_context 和 io 线程
+    RpcClient(std::string host,
+              unsigned short port,
+              size_t max_pending_calls = DEFAULT_MAX_PENDING_CALLS)
         : host_(std::move(host)),
           port_(port),
+          owned_io_service_(std::make_unique<asio::io_context>(1)), // 只由 io 线程运行
+          io_service_(*owned_io_service_),
           socket_(io_service_),
-          work_(io_service_) {
+          deadline_timer_(io_service_),
+          work_(std::in_place, io_service_),
+          pending_calls_(max_pending_calls) {
         work_thread_ = std::thread([this]() { io_service_.run(); });
     }
 
+    // 共享模式: 运行在外部的 io_context 上 (例如 RpcClientPool 的 io 线程),
+    // 不能在该 io_context 的线程中析构
+    RpcClient(asio::io_context& io_service,
+              std::string host,
+              unsigned short port,
+              size_t max_pending_calls = DEFAULT_MAX_PENDING_CALLS)
+        : host_(std::move(host)),
+          port_(port),
+          io_service_(io_service),
+          socket_(io_service_),
+          deadline_timer_(io_service_),
+          pending_calls_(max_pending_calls) {}
+
     ~RpcClient() {
         std::promise<void> promise;
-        // 为防止竞争，close()需要交给RpcClient本身的事件循环来做
+        // 为防止竞争，close()需要交给RpcClient本身的事件循环来做;
+        // 被取消的读写回调排在其后, 再 post 一次等它们执行完, 共享 io_context 时对象才能安全销毁
         io_service_.post([this, &promise] {
-            close();
-            promise.set_value();
+            do_close();
+            deadline_timer_.cancel();
+            asio::post(io_service_, [&promise] { promise.set_value(); });
         });
         promise.get_future().wait();
         stop();
@@ -60,26 +108,60 @@ public:
         return has_connected_;
     }
 
+    // 可在任意线程调用, 关闭交给 io 线程进行: 未完成的调用和流以 "connection closed" 结束,
+    // 其回调与其他回调一样在 io 线程中执行
     void close() {
-        if (!has_connected_) {
-            return;
-        }
-        has_connected_ = false;
-        asio::error_code ec;
-        socket_.shutdown(asio::ip::tcp::socket::shutdown_both, ec);
-        socket_.close(ec);
+        asio::dispatch(io_service_, [this] { do_close(); });
     }
 
     void stop() {
-        work_.~work();
+        work_.reset();
         if (work_thread_.joinable()) {
             work_thread_.join();
         }
     }
 
+    void set_write_batch_limit(WriteBatchLimit limit) {
+        std::lock_guard lock(write_queue_mutex_);
+        write_queue_.set_limit(limit);
+    }
+
+    const IoStats& stats() const { return stats_; }
+
+    // 未指定超时的 async_call/co_call 使用的超时时间, 0 表示不限
+    void set_default_timeout(std::chrono::milliseconds timeout) {
+        default_timeout_ms_.store(static_cast<uint32_t>(timeout.count()),
+                                  std::memory_order_relaxed);
+    }
+
+    // 开启后压缩不小于 threshold 的请求体, 并允许服务端压缩响应; 可在任意线程调用
+    void set_compression(const CompressionOptions& options) {
+        compress_threshold_.store(options.threshold, std::memory_order_relaxed);
+        compress_enabled_.store(options.enabled, std::memory_order_relaxed);
+    }
+
+    // 之后发起的流式调用的窗口 (客户端最多缓存的未消费条目数)
+    void set_stream_window(uint32_t window) {
+        stream_window_.store(window, std::memory_order_relaxed);
+    }
+
+    // 已发出尚未收到响应的请求数
+    size_t outstanding() const { return outstanding_.load(std::memory_order_relaxed); }
+
+    // func 可以是函数名, 也可以是预先算好的 FuncId (见 func_id.hpp), 后者省去每次调用的哈希计算。
+    // TIMEOUT (毫秒) 同时作为请求的 deadline 发给服务端
     template <typename T = void, size_t TIMEOUT = DEFAULT_TIMEOUT, typename... Args>
-    T call(const std::string& rpc_name, Args&&... args) {
-        auto future_result = async_call(rpc_name, std::forward<Args>(args)...);
+    T call(FuncId func, Args&&... args) {
+        return call<T, TIMEOUT>(MsgpackCodec{}, func, std::forward<Args>(args)...);
+    }
+
+    // 指定编码方式的版本 (见 codec.hpp), 如 call<Point>(trpc::RawCodec{}, "move", point, 1.0);
+    // RawCodec 要求参数与结果可平凡拷贝, 且参数类型与服务端 handler 的参数类型完全一致
+    template <typename T = void, size_t TIMEOUT = DEFAULT_TIMEOUT, typename Codec, typename... Args>
+    std::enable_if_t<IsCodec<Codec>::value, T> call(Codec codec, FuncId func, Args&&... args) {
+        static_assert(!IsBorrowed<T>::value, "the result is released on return, use owning types");
+        static_assert(Codec::template accepts<T>, "the codec cannot decode this result type");
+        auto future_result = async_call<TIMEOUT>(codec, func, std::forward<Args>(args)...);
         auto status = future_result.wait_for(std::chrono::milliseconds(TIMEOUT));
         if (status == std::future_status::timeout || status == std::future_status::deferred) {
             CLOG_ERROR("future timeout or deferred");
@@ -92,21 +174,335 @@ public:
         }
     }
 
+    // 超时后结果为 FAIL "deadline exceeded", 超时时间见 set_default_timeout
     template <typename... Args>
-    std::future<RpcResult> async_call(const std::string& rpc_name, Args&&... args) {
-        std::promise<RpcResult> result;
-        uint64_t req_id = request_id_;
-        auto future = result.get_future();
-        {
-            std::lock_guard lock(result_map_mutex_);
-            result_map_.emplace(request_id_++, std::move(result));
-        }
-        auto args_buffer = msgpack_codec::pack_args(std::forward<Args>(args)...);
-        write(req_id, std::move(args_buffer), MD5::MD5Hash32(rpc_name.data()));
+    std::future<RpcResult> async_call(FuncId func, Args&&... args) {
+        return async_call(MsgpackCodec{}, func, std::forward<Args>(args)...);
+    }
+
+    template <typename Codec, typename... Args>
+    std::enable_if_t<IsCodec<Codec>::value, std::future<RpcResult>> async_call(Codec,
+                                                                              FuncId func,
+                                                                              Args&&... args) {
+        PendingCall pending;
+        auto future = pending.promise.emplace().get_future();
+        send_request<Codec>(func, default_timeout(), std::move(pending),
+                            std::forward<Args>(args)...);
+        return future;
+    }
+
+    // 回调版本: 结果到达或超时时在 RpcClient 的 io 线程中调用 callback(RpcResult)
+    template <typename Callback, typename... Args>
+    std::enable_if_t<std::is_invocable_v<Callback, RpcResult>> async_call(
+        FuncId func, Callback&& callback, Args&&... args) {
+        async_call(MsgpackCodec{}, func, std::forward<Callback>(callback),
+                   std::forward<Args>(args)...);
+    }
+
+    template <typename Codec, typename Callback, typename... Args>
+    std::enable_if_t<IsCodec<Codec>::value && std::is_invocable_v<Callback, RpcResult>> async_call(
+        Codec, FuncId func, Callback&& callback, Args&&... args) {
+        PendingCall pending;
+        pending.callback = std::forward<Callback>(callback);
+        send_request<Codec>(func, default_timeout(), std::move(pending),
+                            std::forward<Args>(args)...);
+    }
+
+    // 指定超时时间 (毫秒) 的版本: async_call<100>(name, args...)
+    template <size_t TIMEOUT, typename... Args>
+    std::future<RpcResult> async_call(FuncId func, Args&&... args) {
+        return async_call<TIMEOUT>(MsgpackCodec{}, func, std::forward<Args>(args)...);
+    }
+
+    template <size_t TIMEOUT, typename Codec, typename... Args>
+    std::enable_if_t<IsCodec<Codec>::value, std::future<RpcResult>> async_call(Codec,
+                                                                              FuncId func,
+                                                                              Args&&... args) {
+        PendingCall pending;
+        auto future = pending.promise.emplace().get_future();
+        send_request<Codec>(func, TIMEOUT, std::move(pending), std::forward<Args>(args)...);
         return future;
     }
 
+    template <size_t TIMEOUT, typename Callback, typename... Args>
+    std::enable_if_t<std::is_invocable_v<Callback, RpcResult>> async_call(
+        FuncId func, Callback&& callback, Args&&... args) {
+        async_call<TIMEOUT>(MsgpackCodec{}, func, std::forward<Callback>(callback),
+                            std::forward<Args>(args)...);
+    }
+
+    template <size_t TIMEOUT, typename Codec, typename Callback, typename... Args>
+    std::enable_if_t<IsCodec<Codec>::value && std::is_invocable_v<Callback, RpcResult>> async_call(
+        Codec, FuncId func, Callback&& callback, Args&&... args) {
+        PendingCall pending;
+        pending.callback = std::forward<Callback>(callback);
+        send_request<Codec>(func, TIMEOUT, std::move(pending), std::forward<Args>(args)...);
+    }
+
+#if defined(ASIO_HAS_CO_AWAIT)
+    // 协程版本 (C++20): T result = co_await client.co_call<T>(name, args...);
+    // 结果到达时在 RpcClient 的 io 线程中 dispatch 到协程自身的 executor 上恢复,
+    // 协程运行在 get_executor() 上时不会有额外的线程切换。协程中不要使用阻塞的 call()。
+    template <typename T = void, typename... Args>
+    asio::awaitable<T> co_call(FuncId func, Args... args) {
+        return co_call<T>(MsgpackCodec{}, func, std::move(args)...);
+    }
+
+    template <typename T = void, typename Codec, typename... Args>
+    std::enable_if_t<IsCodec<Codec>::value, asio::awaitable<T>> co_call(Codec,
+                                                                       FuncId func,
+                                                                       Args... args) {
+        static_assert(!IsBorrowed<T>::value, "the result is released on return, use owning types");
+        static_assert(Codec::template accepts<T>, "the codec cannot decode this result type");
+        RpcResult result = co_await asio::async_initiate<decltype(asio::use_awaitable),
+                                                         void(RpcResult)>(
+            [this, func, &args...](auto handler) {
+                // PendingCall::callback 要求可拷贝，用 shared_ptr 包装只能移动的 handler
+                auto shared_handler = std::make_shared<decltype(handler)>(std::move(handler));
+                PendingCall pending;
+                pending.callback = [shared_handler](RpcResult result) {
+                    auto executor = asio::get_associated_executor(*shared_handler);
+                    asio::dispatch(executor,
+                                   [shared_handler, result = std::move(result)]() mutable {
+                                       std::move(*shared_handler)(std::move(result));
+                                   });
+                };
+                send_request<Codec>(func, default_timeout(), std::move(pending),
+                                    std::move(args)...);
+            },
+            asio::use_awaitable);
+        if constexpr (std::is_void_v<T>) {
+            result.check_result();
+        } else {
+            co_return result.template as<T>();
+        }
+    }
+#endif
+
+    asio::any_io_executor get_executor() { return io_service_.get_executor(); }
+
+    // 流式调用 (服务端以 register_stream_handler 注册): 条目到达后即可从返回的 RpcStream 中取出,
+    // 不必等待整个结果。客户端最多缓存 stream window 个未取出的条目, 之后服务端暂停发送,
+    // 内存占用有上限; 等待下一个条目超过默认超时 (见 set_default_timeout) 时失败
+    //   for (auto& row : client.stream<Row>("scan", from, to)) { ... }
+    template <typename T, typename... Args>
+    RpcStream<T> stream(FuncId func, Args&&... args) {
+        static_assert(!IsBorrowed<T>::value,
+                      "stream items are released after use, use owning types");
+        auto state =
+            std::make_shared<StreamQueue<T>>(stream_window_.load(std::memory_order_relaxed));
+        open_stream(func, state, std::forward<Args>(args)...);
+        return RpcStream<T>(std::move(state), std::chrono::milliseconds(default_timeout()));
+    }
+
+    // 回调形式: on_item(T) 在 io 线程中依次调用, 不能阻塞, 返回 false 时取消流;
+    // 结束、失败或取消时调用一次 on_done, 其中的 message 只在回调期间有效
+    template <typename T, typename... Args>
+    void stream_call(FuncId func,
+                     std::function<bool(T)> on_item,
+                     std::function<void(ResultStatus)> on_done,
+                     Args&&... args) {
+        static_assert(!IsBorrowed<T>::value,
+                      "stream items are released after use, use owning types");
+        auto state = std::make_shared<StreamCallback<T>>(
+            stream_window_.load(std::memory_order_relaxed), std::move(on_item), std::move(on_done));
+        open_stream(func, std::move(state), std::forward<Args>(args)...);
+    }
+
 private:
+    using buffer_type = msgpack_codec::buffer_type;
+    static constexpr size_t MAX_FREE_BUFFERS = 64;
+    static constexpr size_t DEFAULT_READ_BUFFER_SIZE = 64 * 1024;
+    static constexpr uint32_t DEFAULT_ASYNC_TIMEOUT_MS = 10 * 1000;
+    // deadline 堆中已完成调用的条目超过一定数量时整体清理一次
+    static constexpr size_t MIN_DEADLINES_TO_PRUNE = 1024;
+    using clock_type = std::chrono::steady_clock;
+
+    struct Deadline {
+        clock_type::time_point when;
+        uint64_t request_id;
+        bool operator>(const Deadline& other) const { return when > other.when; }
+    };
+
+    size_t default_timeout() const { return default_timeout_ms_.load(std::memory_order_relaxed); }
+
+    template <typename Codec, typename... Args>
+    void send_request(FuncId func, size_t timeout_ms, PendingCall pending, Args&&... args) {
+        uint64_t req_id;
+        if (!pending_calls_.insert(pending, req_id)) {
+            throw std::runtime_error("too many pending calls");
+        }
+        outstanding_.fetch_add(1, std::memory_order_relaxed);
+        auto deadline = timeout_ms == 0
+                            ? clock_type::time_point::max()
+                            : clock_type::now() + std::chrono::milliseconds(timeout_ms);
+        buffer_type frame;
+        try {
+            frame = pack_request<Codec>(func, timeout_ms, req_id, 0, std::forward<Args>(args)...);
+        } catch (...) {
+            // 编码失败时撤销登记, 异常交给调用者; 期间被 close() 取走的调用已经以失败结束
+            if (pending_calls_.take(req_id, pending)) {
+                outstanding_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            throw;
+        }
+        write(std::move(frame), req_id, deadline);
+    }
+
+    // 打开流: 先发送请求, 再授予一个窗口的 credit。流没有整体的超时, 服务端也不检查 deadline
+    template <typename... Args>
+    void open_stream(FuncId func, std::shared_ptr<StreamState> state, Args&&... args) {
+        uint64_t id = next_stream_id_.fetch_add(1, std::memory_order_relaxed);
+        uint32_t window = state->window();
+        state->set_control([this, id](uint32_t flags, uint32_t credits) {
+            send_stream_control(id, flags, credits);
+        });
+        {
+            std::lock_guard lock(streams_mutex_);
+            streams_.emplace(id, std::move(state));
+        }
+        write(pack_request<MsgpackCodec>(func, 0, id, STREAM_FLAG, std::forward<Args>(args)...), id,
+              clock_type::time_point::max());
+        send_stream_control(id, STREAM_CREDIT_FLAG, window);
+    }
+
+    // credit 或 cancel 帧, 可在任意线程调用; 取消的流立即从流表中移除
+    void send_stream_control(uint64_t id, uint32_t flags, uint32_t credits) {
+        if ((flags & STREAM_CANCEL_FLAG) != 0) {
+            std::lock_guard lock(streams_mutex_);
+            streams_.erase(id);
+        }
+        buffer_type frame;
+        {
+            std::lock_guard lock(write_queue_mutex_);
+            frame = buffer_pool_.acquire();
+        }
+        frame.resize(RPC_HEAD_LEN + sizeof(uint32_t));
+        RpcHeader header{id, sizeof(uint32_t), 0, 0, STREAM_FLAG | flags};
+        std::memcpy(frame.data(), &header, RPC_HEAD_LEN);
+        store_u32_le(frame.data() + RPC_HEAD_LEN, credits);
+        write(std::move(frame), id, clock_type::time_point::max());
+    }
+
+    // 只在 io 线程中调用
+    void do_close() {
+        fail_streams();
+        fail_pending_calls();
+        if (!has_connected_) {
+            return;
+        }
+        has_connected_ = false;
+        asio::error_code ec;
+        socket_.shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+        socket_.close(ec);
+    }
+
+    // 连接断开: 未结束的流都以失败结束
+    void fail_streams() {
+        std::unordered_map<uint64_t, std::shared_ptr<StreamState>> streams;
+        {
+            std::lock_guard lock(streams_mutex_);
+            streams.swap(streams_);
+        }
+        for (auto& [id, state] : streams) {
+            state->on_end(RpcResult::error("connection closed"));
+        }
+    }
+
+    // 连接断开: 未完成的调用立即以失败结束, 不必等到各自的 deadline
+    void fail_pending_calls() {
+        pending_calls_.drain([this](uint64_t, PendingCall pending) {
+            outstanding_.fetch_sub(1, std::memory_order_relaxed);
+            complete(pending, RpcResult::error("connection closed"));
+        });
+    }
+
+    // 编码请求帧, 帧头 flags 为编码方式与 flags
+    template <typename Codec, typename... Args>
+    buffer_type pack_request(FuncId func,
+                             size_t timeout_ms,
+                             uint64_t req_id,
+                             uint32_t flags,
+                             Args&&... args) {
+        // 复用已发送的缓冲区; 池为空时按精确的编码长度分配, 帧头直接写在参数前面
+        buffer_type buffer;
+        {
+            std::lock_guard lock(write_queue_mutex_);
+            buffer = buffer_pool_.acquire();
+        }
+        if (buffer.capacity() == 0) {
+            buffer.reserve(RPC_HEAD_LEN + Codec::args_size(args...));
+        }
+        buffer.resize(RPC_HEAD_LEN);
+        Codec::pack_args(buffer, std::forward<Args>(args)...);
+        RpcHeader header{req_id, static_cast<uint32_t>(buffer.size() - RPC_HEAD_LEN),
+                         func.value,
+                         static_cast<uint32_t>(std::min<size_t>(timeout_ms, UINT32_MAX)),
+                         static_cast<uint32_t>(Codec::TYPE) | flags};
+        bool compress = compress_enabled_.load(std::memory_order_relaxed);
+        if (compress) {
+            header.flags |= ACCEPT_COMPRESSED_FLAG;
+        }
+        std::memcpy(buffer.data(), &header, RPC_HEAD_LEN);
+        if (compress) { // 在调用线程中压缩
+            compression::compress_frame(
+                buffer, compress_threshold_.load(std::memory_order_relaxed), stats_);
+        }
+        return buffer;
+    }
+
+    // 在 io 线程中调用: 按最早的 deadline 设置定时器
+    void arm_deadline_timer() {
+        std::lock_guard lock(write_queue_mutex_);
+        // 已收到响应的调用不必再等到 deadline
+        while (!deadlines_.empty() && !pending_calls_.contains(deadlines_.front().request_id)) {
+            pop_deadline();
+        }
+        if (deadlines_.empty()) {
+            timer_expiry_ = clock_type::time_point::max();
+            return;
+        }
+        timer_expiry_ = deadlines_.front().when;
+        deadline_timer_.expires_at(timer_expiry_);
+        deadline_timer_.async_wait([this](asio::error_code ec) {
+            if (ec != asio::error::operation_aborted) {
+                expire_calls();
+            }
+        });
+    }
+
+    // 以超时结果完成所有已到期且尚未收到响应的调用
+    void expire_calls() {
+        std::vector<uint64_t> expired_ids;
+        {
+            std::lock_guard lock(write_queue_mutex_);
+            auto now = clock_type::now();
+            while (!deadlines_.empty() && deadlines_.front().when <= now) {
+                expired_ids.push_back(deadlines_.front().request_id);
+                pop_deadline();
+            }
+            timer_expiry_ = clock_type::time_point::max();
+        }
+        for (uint64_t id : expired_ids) {
+            PendingCall pending;
+            if (!pending_calls_.take(id, pending)) {
+                continue; // 已经收到响应
+            }
+            outstanding_.fetch_sub(1, std::memory_order_relaxed);
+            stats_.expired.fetch_add(1, std::memory_order_relaxed);
+            complete(pending, RpcResult::error("deadline exceeded"));
+        }
+        arm_deadline_timer();
+    }
+
+    static void complete(PendingCall& pending, RpcResult result) {
+        if (pending.callback) {
+            pending.callback(std::move(result));
+        } else {
+            pending.promise->set_value(std::move(result));
+        }
+    }
+
     void async_connect() {
         auto addr = asio::ip::address::from_string(host_);
         socket_.async_connect({addr, port_}, [this](asio::error_code ec) {
@@ -125,48 +521,70 @@ private:
         });
     }
 
-    void write(uint64_t request_id, msgpack_codec::buffer_type&& buffer, uint32_t func_id) {
-        RpcMsg msg;
-        size_t len = buffer.size();
-        msg.header = {request_id, static_cast<uint32_t>(len), func_id};
-        msg.content = std::string(buffer.data(), len);
-
+    void write(buffer_type&& frame, uint64_t req_id, clock_type::time_point deadline) {
         std::lock_guard lock(write_queue_mutex_);
-        write_queue_.emplace_back(std::move(msg));
-        if (write_queue_.size() > 1) {
-            // 上次注册的 async_write 还未执行完，不要重复注册
+        if (deadline != clock_type::time_point::max()) {
+            push_deadline({deadline, req_id});
+            if (deadline < timer_expiry_) {
+                timer_expiry_ = deadline;
+                asio::post(io_service_, [this] { arm_deadline_timer(); });
+            }
+        }
+        write_queue_.push(std::move(frame));
+        if (write_queue_.writing()) {
+            // 上次注册的 async_write 还未执行完，不要重复注册; 完成后会把积累的帧一次写出
             return;
         }
 
         do_write();
     }
 
+    // deadline 堆的操作, 调用者需持有 write_queue_mutex_。
+    // 正常完成的调用不会立即从堆中移除, 堆的大小超过未完成调用数的两倍时一次性清理, 均摊 O(1)
+    void push_deadline(const Deadline& deadline) {
+        if (deadlines_.size() >= std::max(MIN_DEADLINES_TO_PRUNE, 2 * outstanding())) {
+            deadlines_.erase(std::remove_if(deadlines_.begin(), deadlines_.end(),
+                                            [this](const Deadline& d) {
+                                                return !pending_calls_.contains(d.request_id);
+                                            }),
+                             deadlines_.end());
+            std::make_heap(deadlines_.begin(), deadlines_.end(), std::greater<>());
+        }
+        deadlines_.push_back(deadline);
+        std::push_heap(deadlines_.begin(), deadlines_.end(), std::greater<>());
+    }
+
+    void pop_deadline() {
+        std::pop_heap(deadlines_.begin(), deadlines_.end(), std::greater<>());
+        deadlines_.pop_back();
+    }
+
+    // 调用者需持有 write_queue_mutex_
     void do_write() {
-        auto& msg = write_queue_.front();
-        std::array<asio::const_buffer, 2> write_buffers;
-        write_buffers[0] = asio::buffer(&msg.header, sizeof(msg.header));
-        write_buffers[1] = asio::buffer(msg.content.data(), msg.content.size());
-        asio::async_write(socket_, write_buffers, [this](asio::error_code ec, size_t len) {
+        BatchBuffers buffers = write_queue_.next_batch();
+        stats_.on_write_batch(write_queue_.batch_frames(), write_queue_.batch_bytes());
+        asio::async_write(socket_, buffers, [this](asio::error_code ec, size_t len) {
             if (ec) {
                 CLOG_WARN("asio error happened, {}: {}", ec.value(), ec.message());
                 has_connected_ = false;
-                close();
+                do_close();
                 return;
             }
             std::lock_guard lock(write_queue_mutex_);
-            write_queue_.pop_front();
-            if (!write_queue_.empty()) {
+            write_queue_.finish_batch(buffer_pool_);
+            if (write_queue_.has_pending()) {
                 do_write(); // 将队列全写出去
             }
         });
     }
 
     void do_read() {
-        asio::async_read(socket_, asio::buffer(header_buffer_.data(), RPC_HEAD_LEN),
-                         [this](asio::error_code ec, size_t len) { read_head_handler(ec, len); });
+        read_buffer_.reserve_for_next();
+        socket_.async_read_some(read_buffer_.prepare(),
+                                [this](asio::error_code ec, size_t len) { on_read(ec, len); });
     }
 
-    void read_head_handler(asio::error_code ec, size_t len) {
+    void on_read(asio::error_code ec, size_t len) {
         if (!socket_.is_open()) {
             CLOG_WARN("socket already closed");
             has_connected_ = false;
@@ -174,59 +592,75 @@ private:
         }
         if (ec) {
             CLOG_WARN("asio error happened, {}: {}", ec.value(), ec.message());
-            close();
+            do_close();
             return;
         }
-        RpcHeader* header = reinterpret_cast<RpcHeader*>(header_buffer_.data());
-        uint32_t body_len = header->body_len;
-        if (body_len == 0) {
-            CLOG_ERROR("Invalid body len");
-            close();
-            return;
+        read_buffer_.commit(len);
+        // 一次读取中可能包含多个响应帧，逐个分发
+        RpcHeader header;
+        std::string_view body;
+        uint64_t frames = 0;
+        while (read_buffer_.next_frame(header, body)) {
+            ++frames;
+            if (header.body_len == 0) {
+                CLOG_ERROR("Invalid body len");
+                do_close();
+                return;
+            }
+            if ((header.flags & STREAM_FLAG) != 0) {
+                handle_stream(header, body);
+            } else {
+                handle_result(header, body);
+            }
         }
-        read_body(header->request_id, body_len);
+        stats_.on_read_batch(frames);
+        do_read();
     }
 
-    void read_body(uint64_t request_id, size_t body_len) {
-        if (body_len > body_buffer_.size()) {
-            body_buffer_.resize(body_len);
+    void handle_result(const RpcHeader& header, std::string_view body) {
+        PendingCall pending;
+        if (!pending_calls_.take(header.request_id, pending)) {
+            return; // 已超时或未知的响应
         }
-        asio::async_read(socket_, asio::buffer(body_buffer_.data(), body_len),
-                         [this, request_id](asio::error_code ec, size_t len) {
-                             read_body_handler(request_id, ec, len);
-                         });
+        outstanding_.fetch_sub(1, std::memory_order_relaxed);
+        complete(pending, make_result(header, body));
     }
 
-    void read_body_handler(uint64_t request_id, asio::error_code ec, size_t len) {
-        if (!socket_.is_open()) {
-            CLOG_WARN("socket already closed");
-            handle_result(request_id, asio::error::make_error_code(asio::error::connection_aborted),
-                          {});
-            return;
+    void handle_stream(const RpcHeader& header, std::string_view body) {
+        bool end = (header.flags & STREAM_END_FLAG) != 0;
+        std::shared_ptr<StreamState> state;
+        {
+            std::lock_guard lock(streams_mutex_);
+            auto it = streams_.find(header.request_id);
+            if (it == streams_.end()) {
+                return; // 已取消
+            }
+            state = it->second;
+            if (end) {
+                streams_.erase(it);
+            }
         }
-        if (ec) {
-            CLOG_WARN("asio error happened, {}: {}", ec.value(), ec.message());
-            has_connected_ = false;
-            handle_result(request_id, ec, {});
-            close();
+        if (end) {
+            state->on_end(make_result(header, body));
         } else {
-            handle_result(request_id, ec, {body_buffer_.data(), len});
-            do_read();
+            state->on_frame(make_result(header, body));
         }
     }
 
-    void handle_result(uint64_t request_id, asio::error_code ec, std::string_view data) {
-        std::lock_guard lock(result_map_mutex_);
-        if (result_map_.find(request_id) == result_map_.end()) {
-            return;
+    // 压缩的响应体先解压; 读缓冲区在多个帧之间共用, 小帧拷贝一次, 独占扩容缓冲区的大帧直接接管
+    RpcResult make_result(const RpcHeader& header, std::string_view body) {
+        Buffer storage;
+        if ((header.flags & COMPRESSED_FLAG) != 0) {
+            if (!compression::decompress_body(body, storage, stats_)) {
+                return RpcResult::error("bad compressed response");
+            }
+            std::string_view raw(storage.data(), storage.size());
+            return RpcResult(std::move(storage), raw, codec_of(header));
         }
-        auto& future = result_map_[request_id];
-        if (ec) {
-            future.set_value(RpcResult{""});
-        } else {
-            future.set_value(RpcResult{data});
+        if (read_buffer_.release_frame(body, storage)) {
+            return RpcResult(std::move(storage), body, codec_of(header));
         }
-        result_map_.erase(request_id);
+        return RpcResult(body, codec_of(header));
     }
 
     std::string host_;
@@ -236,19 +670,34 @@ private:
     std::mutex connection_mutex_;
     std::condition_variable connection_cv_;
 
-    asio::io_context io_service_;
+    std::unique_ptr<asio::io_context> owned_io_service_; // 仅独立模式下持有
+    asio::io_context& io_service_;
     asio::ip::tcp::socket socket_;
-    asio::io_context::work work_;
+    asio::steady_timer deadline_timer_;
+    std::optional<asio::io_context::work> work_;
     std::thread work_thread_;
 
-    std::array<char, RPC_HEAD_LEN> header_buffer_;
-    std::vector<char> body_buffer_;
-    std::unordered_map<uint64_t, std::promise<RpcResult>> result_map_;
-    std::mutex result_map_mutex_;
+    ReadBuffer read_buffer_{DEFAULT_READ_BUFFER_SIZE};
+    PendingTable<PendingCall> pending_calls_; // 同时负责分配请求 id
+    std::atomic<size_t> outstanding_{0};
 
-    uint64_t request_id_{0};
+    // 调用的 deadline, 以 when 排序的最小堆 (见 push_deadline), 由 write_queue_mutex_ 保护
+    std::vector<Deadline> deadlines_;
+    clock_type::time_point timer_expiry_{clock_type::time_point::max()};
+    std::atomic<uint32_t> default_timeout_ms_{DEFAULT_ASYNC_TIMEOUT_MS};
+    std::atomic<bool> compress_enabled_{false};
+    std::atomic<size_t> compress_threshold_{CompressionOptions{}.threshold};
+    std::atomic<uint32_t> stream_window_{DEFAULT_STREAM_WINDOW};
 
-    std::deque<RpcMsg> write_queue_;
+    // 流式调用, 以流 id (独立于普通请求的 id) 为键; 帧头带 STREAM_FLAG 的响应交给这里
+    std::mutex streams_mutex_;
+    std::unordered_map<uint64_t, std::shared_ptr<StreamState>> streams_;
+    std::atomic<uint64_t> next_stream_id_{1};
+
+    WriteQueue write_queue_;
+    BufferPool buffer_pool_{MAX_FREE_BUFFERS, MAX_RETAINED_BUFFER_SIZE};
     std::mutex write_queue_mutex_;
+
+    IoStats stats_;
 };
 } // namespace trpc
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "asio/detail/noncopyable.hpp"
+#include "clog/clog.h"
+#include "trpc/io_service_pool.hpp"
+#include "trpc/rpc_client.hpp"
+
+namespace trpc {
+// 到同一服务端的多个连接, 分布在 threads 个 io 线程上。
+// 每次调用选择未完成请求最少的连接, 接口与 RpcClient 相同。
+class RpcClientPool : asio::noncopyable {
+public:
+    RpcClientPool(const std::string& host,
+                  unsigned short port,
+                  size_t connections,
+                  size_t threads,
+                  const IoServicePoolOptions& io_options = {},
+                  size_t max_pending_calls = DEFAULT_MAX_PENDING_CALLS)
+        : io_service_pool_(threads, io_options) {
+        if (connections == 0) {
+            connections = 1;
+        }
+        for (size_t i = 0; i < connections; ++i) {
+            clients_.push_back(std::make_unique<RpcClient>(io_service_pool_.next_io_service(), host,
+                                                           port, max_pending_calls));
+        }
+        io_thread_ = std::thread([this] { io_service_pool_.run(); });
+    }
+
+    ~RpcClientPool() {
+        clients_.clear(); // 先关闭所有连接, 再停止 io 线程
+        io_service_pool_.stop();
+        if (io_thread_.joinable()) {
+            io_thread_.join();
+        }
+    }
+
+    // 所有连接均建立成功时返回 true
+    bool connect(size_t timeout = 3) {
+        bool ok = true;
+        for (auto& client : clients_) {
+            ok = client->connect(timeout) && ok;
+        }
+        return ok;
+    }
+
+    bool has_connected() const {
+        for (auto& client : clients_) {
+            if (!client->has_connected()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 对所有连接生效, 见 RpcClient::set_compression
+    void set_compression(const CompressionOptions& options) {
+        for (auto& client : clients_) {
+            client->set_compression(options);
+        }
+    }
+
+    template <typename T = void, size_t TIMEOUT = DEFAULT_TIMEOUT, typename... Args>
+    T call(FuncId func, Args&&... args) {
+        return pick().template call<T, TIMEOUT>(func, std::forward<Args>(args)...);
+    }
+
+    template <typename T = void, size_t TIMEOUT = DEFAULT_TIMEOUT, typename Codec, typename... Args>
+    std::enable_if_t<IsCodec<Codec>::value, T> call(Codec codec, FuncId func, Args&&... args) {
+        return pick().template call<T, TIMEOUT>(codec, func, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    auto async_call(FuncId func, Args&&... args) {
+        return pick().async_call(func, std::forward<Args>(args)...);
+    }
+
+    template <typename Codec,
+              typename... Args,
+              typename = std::enable_if_t<IsCodec<Codec>::value>>
+    auto async_call(Codec codec, FuncId func, Args&&... args) {
+        return pick().async_call(codec, func, std::forward<Args>(args)...);
+    }
+
+    template <typename T, typename... Args>
+    RpcStream<T> stream(FuncId func, Args&&... args) {
+        return pick().template stream<T>(func, std::forward<Args>(args)...);
+    }
+
+    template <typename T, typename... Args>
+    void stream_call(FuncId func,
+                     std::function<bool(T)> on_item,
+                     std::function<void(ResultStatus)> on_done,
+                     Args&&... args) {
+        pick().template stream_call<T>(func, std::move(on_item), std::move(on_done),
+                                       std::forward<Args>(args)...);
+    }
+
+#if defined(ASIO_HAS_CO_AWAIT)
+    template <typename T = void, typename... Args>
+    asio::awaitable<T> co_call(FuncId func, Args... args) {
+        return pick().template co_call<T>(func, std::move(args)...);
+    }
+
+    template <typename T = void, typename Codec, typename... Args>
+    std::enable_if_t<IsCodec<Codec>::value, asio::awaitable<T>> co_call(Codec codec,
+                                                                       FuncId func,
+                                                                       Args... args) {
+        return pick().template co_call<T>(codec, func, std::move(args)...);
+    }
+#endif
+
+    size_t size() const { return clients_.size(); }
+    RpcClient& client(size_t index) { return *clients_[index]; }
+
+    // 选择未完成请求最少的已连接的连接; 从轮转位置开始扫描, 负载相同时依次分散
+    RpcClient& pick() {
+        size_t n = clients_.size();
+        size_t start = next_.fetch_add(1, std::memory_order_relaxed);
+        RpcClient* best = nullptr;
+        size_t best_outstanding = 0;
+        for (size_t i = 0; i < n; ++i) {
+            RpcClient* client = clients_[(start + i) % n].get();
+            if (!client->has_connected()) {
+                continue;
+            }
+            size_t outstanding = client->outstanding();
+            if (best == nullptr || outstanding < best_outstanding) {
+                best = client;
+                best_outstanding = outstanding;
+                if (outstanding == 0) {
+                    break;
+                }
+            }
+        }
+        return best != nullptr ? *best : *clients_[start % n];
+    }
+
+private:
+    IoServicePool io_service_pool_;
+    std::thread io_thread_;
+    std::vector<std::unique_ptr<RpcClient>> clients_;
+    std::atomic<size_t> next_{0};
+};
+} // namespace trpc
@@ -1,42 +1,178 @@
 #pragma once
+#include <string>
 #include <string_view>
+#include <type_traits>
 
+#include "trpc/buffer.hpp"
 #include "trpc/codec.hpp"
 #include "trpc/message.h"
 
 namespace trpc {
+// 一次调用的结果, 持有响应体 (msgpack 编码时为 tuple<int code, value>, RawCodec 见 codec.hpp)。
+// status/try_as/as 都只解码一遍, 字符串直接引用响应体, 因此 as<std::string_view>() 等
+// 借用类型的结果在 RpcResult 销毁前有效。
 class RpcResult {
 public:
-    RpcResult(std::string_view data)
-        : content_(data.data(), data.size()) {}
+    // 拷贝 data
+    RpcResult(std::string_view data, CodecType codec = CodecType::MSGPACK)
+        : storage_(data.size()),
+          codec_(codec) {
+        if (!data.empty()) {
+            storage_.write(data.data(), data.size());
+        }
+        body_ = std::string_view(storage_.data(), storage_.size());
+    }
+
+    // 接管 storage, body 指向其中的响应体
+    RpcResult(Buffer storage, std::string_view body, CodecType codec = CodecType::MSGPACK)
+        : storage_(std::move(storage)),
+          body_(body),
+          codec_(codec) {}
+
+    // 拷贝只复制响应体本身 (不复制接管来的整个读缓冲区), body 指向新的副本
+    RpcResult(const RpcResult& other)
+        : RpcResult(other.body_, other.codec_) {}
+
+    RpcResult& operator=(const RpcResult& other) {
+        if (this != &other) {
+            *this = RpcResult(other);
+        }
+        return *this;
+    }
+
+    // 移动时缓冲区的内存不变, body 仍然有效
+    RpcResult(RpcResult&&) noexcept = default;
+    RpcResult& operator=(RpcResult&&) noexcept = default;
+
+    // 本地产生的失败结果 (如超时), check_result() 时抛出 message
+    static RpcResult error(std::string_view message) {
+        Buffer buffer;
+        msgpack_codec::pack_args_to(buffer, FuncResultCode::FAIL, message);
+        std::string_view body(buffer.data(), buffer.size());
+        return RpcResult(std::move(buffer), body);
+    }
+
+    // 失败时抛出 std::logic_error(失败原因), 类型不匹配时抛出 std::invalid_argument
+    template <typename T>
+    T as() const {
+        if (codec_ == CodecType::RAW) {
+            if constexpr (RawCodec::accepts<T>) {
+                static_assert(std::is_default_constructible_v<T>,
+                              "RawCodec decodes into a default-constructed value, "
+                              "use try_as for result types without a default constructor");
+                T value;
+                ResultStatus status = RawCodec::unpack_result(body_, &value);
+                if (!status.ok()) {
+                    throw std::logic_error(std::string(status.message));
+                }
+                return value;
+            } else {
+                throw std::invalid_argument("unpack failed: raw result of non-trivial type");
+            }
+        }
+        ZoneScope scope;
+        msgpack::object value;
+        ResultStatus status = decode(scope.zone, value);
+        if (!status.ok()) {
+            throw std::logic_error(std::string(status.message));
+        }
+        try {
+            return value.as<T>();
+        } catch (...) {
+            throw std::invalid_argument("unpack failed: Args not match!");
+        }
+    }
 
+    // 不抛异常的版本: 成功时写入 value, 类型不匹配视为失败
     template <typename T>
-    T as() {
-        if (content_.empty()) {
-            throw std::logic_error("empty result!");
+    ResultStatus try_as(T& value) const noexcept {
+        if (codec_ == CodecType::RAW) {
+            if constexpr (RawCodec::accepts<T>) {
+                return RawCodec::unpack_result(body_, &value);
+            } else {
+                return {FuncResultCode::FAIL, "result type mismatch"};
+            }
+        }
+        ZoneScope scope;
+        msgpack::object obj;
+        ResultStatus status = decode(scope.zone, obj);
+        if (!status.ok()) {
+            return status;
+        }
+        try {
+            obj.convert(value);
+        } catch (...) {
+            return {FuncResultCode::FAIL, "result type mismatch"};
+        }
+        return status;
+    }
+
+    // 只检查状态, 不解码返回值
+    ResultStatus status() const noexcept {
+        if (codec_ == CodecType::RAW) {
+            return RawCodec::unpack_result<void>(body_, nullptr);
         }
-        check_result();
-        msgpack::object_handle obj;
-        auto res = msgpack_codec::unpack<std::tuple<int, T>>(obj, content_.data(), content_.size());
-        return std::get<1>(res);
+        ZoneScope scope;
+        msgpack::object value;
+        return decode(scope.zone, value);
     }
 
-    void check_result() {
-        msgpack::object_handle obj;
-        auto tp = msgpack_codec::unpack<std::tuple<int>>(obj, content_.data(), content_.size());
-        if (std::get<0>(tp) != static_cast<int>(FuncResultCode::OK)) {
-            throw std::logic_error(get_error_msg());
+    void check_result() const {
+        ResultStatus result = status();
+        if (!result.ok()) {
+            throw std::logic_error(std::string(result.message));
         }
     }
 
+    std::string_view body() const { return body_; }
+    CodecType codec() const { return codec_; }
+
 private:
-    std::string get_error_msg() {
-        msgpack::object_handle obj;
-        auto tp = msgpack_codec::unpack<std::tuple<int, std::string>>(obj, content_.data(),
-                                                                      content_.size());
-        return std::get<1>(tp);
+    // 解码用的 zone 每个线程一个, 用完即 clear() 复用。
+    // 字符串引用响应体, zone 中只有数组等结构, 解码得到的值不依赖它
+    struct ZoneScope {
+        ZoneScope()
+            : zone(thread_zone()) {}
+        ~ZoneScope() { zone.clear(); }
+        msgpack::zone& zone;
+    };
+
+    static msgpack::zone& thread_zone() {
+        static thread_local msgpack::zone zone;
+        return zone;
     }
-    std::string content_;
+
+    // 一次解码得到状态码和返回值 (失败时 value 为失败原因)
+    ResultStatus decode(msgpack::zone& zone, msgpack::object& value) const noexcept {
+        if (body_.empty()) {
+            return {FuncResultCode::FAIL, "empty result!"};
+        }
+        try {
+            msgpack::object obj =
+                msgpack::unpack(zone, body_.data(), body_.size(), msgpack_codec::reference_all);
+            if (obj.type != msgpack::type::ARRAY || obj.via.array.size == 0) {
+                return {FuncResultCode::FAIL, "bad result format"};
+            }
+            const msgpack::object* items = obj.via.array.ptr;
+            if (obj.via.array.size > 1) {
+                value = items[1];
+            }
+            if (items[0].as<int>() == static_cast<int>(FuncResultCode::OK)) {
+                return {};
+            }
+            std::string_view message;
+            if (value.type == msgpack::type::STR) {
+                message = std::string_view(value.via.str.ptr, value.via.str.size);
+            }
+            return {FuncResultCode::FAIL, message};
+        } catch (...) {
+            return {FuncResultCode::FAIL, "bad result format"};
+        }
+    }
+
+    Buffer storage_;
+    std::string_view body_;
+    CodecType codec_{CodecType::MSGPACK};
 };
 
 } // namespace trpc
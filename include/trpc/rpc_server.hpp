@@ -1,31 +1,88 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
-#include <condition_variable>
+#include <future>
+#include <memory>
+#include <stdexcept>
 #include <thread>
-#include <unordered_map>
+#include <vector>
 
 #include "asio.hpp"
+#include "trpc/connection.hpp"
+#include "trpc/connection_balancer.hpp"
 #include "trpc/io_service_pool.hpp"
 #include "trpc/router.hpp"
+#include "trpc/worker_pool.hpp"
 
 namespace trpc {
 using asio::ip::tcp;
+
+// handler 的执行位置: 默认直接在 io 线程中执行；耗时的 handler 可以交给 WorkerPool,
+// 结果再 post 回连接所在的 io_context 写出
+struct HandlerOptions {
+    enum class Executor {
+        IO_THREAD,
+        SHARED_POOL,    // 所有 SHARED_POOL handler 共用一个 WorkerPool, 见 set_shared_pool
+        DEDICATED_POOL, // 该 handler 独占一个 WorkerPool
+    };
+    Executor executor = Executor::IO_THREAD;
+    size_t threads = 1;      // DEDICATED_POOL 线程数
+    size_t max_queue = 1024; // DEDICATED_POOL 队列上限, 超过时直接返回 "server busy"
+    Compression compression = Compression::DEFAULT; // 响应是否压缩, 默认沿用 ServerOptions
+};
+
+struct ServerOptions {
+    size_t timeout_seconds = 15; // 连接空闲超时, 0 表示不超时
+    // true: 每个 io_context 各有一个设置了 SO_REUSEPORT 的 acceptor, 由内核把新连接分散到各线程,
+    // 连接由接受它的线程处理; false: 单个 acceptor, 新连接轮流分配给各 io_context
+    bool reuse_port = false;
+    IoServicePoolOptions io_options; // io 线程的并发提示与 CPU 绑定
+    BalanceOptions balance;          // io_context 间负载持续不均衡时迁移连接, 默认关闭
+    // 响应的压缩, 只对声明能够解压的请求方生效; 收到的压缩请求总会解压
+    CompressionOptions compression;
+};
+
 class RpcServer : asio::noncopyable {
 public:
-    RpcServer(unsigned short port,
-              size_t pool_size,
-              size_t timeout_seconds = 15,
-              size_t check_seconds = 10)
-        : io_service_pool_(pool_size),
-          acceptor_(io_service_pool_.next_io_service(), tcp::endpoint(tcp::v4(), port)),
-          timeout_seconds_(timeout_seconds),
-          check_seconds_(check_seconds),
+    RpcServer(unsigned short port, size_t pool_size, size_t timeout_seconds = 15)
+        : RpcServer(port, pool_size, ServerOptions{timeout_seconds}) {}
+
+    RpcServer(unsigned short port, size_t pool_size, const ServerOptions& options)
+        : io_service_pool_(pool_size, options.io_options),
           signals_(io_service_pool_.next_io_service()) {
-        do_accept();
-        clean_thread_ = std::thread([this]() { do_clean(); });
+        size_t timeout_seconds = options.timeout_seconds;
+        conn_options_.timeout_seconds = timeout_seconds;
+        conn_options_.compression = options.compression;
+        for (size_t i = 0; i < io_service_pool_.size(); ++i) {
+            registries_.push_back(std::make_unique<Registry>());
+            io_stats_.push_back(std::make_unique<IoStats>());
+        }
+        if (timeout_seconds > 0) {
+            // 每个 io_context 一个时间轮, 以 1s 为 tick 检查空闲连接
+            for (size_t i = 0; i < io_service_pool_.size(); ++i) {
+                idle_wheels_.push_back(std::make_unique<IdleWheel>(
+                    io_service_pool_.get_io_service(i), std::chrono::seconds(1), timeout_seconds));
+            }
+        }
+        if (options.reuse_port) {
+            for (size_t i = 0; i < io_service_pool_.size(); ++i) {
+                listeners_.push_back(listen(port, i, true));
+            }
+        } else {
+            listeners_.push_back(listen(port, io_service_pool_.next_index(), false));
+        }
+        for (auto& listener : listeners_) {
+            do_accept(*listener);
+        }
+        if (options.balance.interval_ms > 0 && io_service_pool_.size() > 1) {
+            balancer_ = std::make_unique<ConnectionBalancer>(
+                io_service_pool_, registries_,
+                [this](size_t index) { return make_connection(index); }, options.balance);
+        }
         running = true;
-        CLOG_INFO("RPC Server running with {} threads", pool_size);
+        CLOG_INFO("RPC Server running with {} threads, {} acceptors", pool_size,
+                  listeners_.size());
 
         signals_.add(SIGINT);
         signals_.add(SIGTERM);
@@ -48,76 +105,230 @@ public:
         router_.register_handler(name, std::forward<F>(f), self);
     }
 
-    void run() { io_service_pool_.run(); }
+    template <typename F>
+    void register_handler(const std::string& name, F&& f, const HandlerOptions& options) {
+        router_.register_handler(name, std::forward<F>(f));
+        apply_options(name, options);
+    }
+
+    template <typename F, typename Self>
+    void register_handler(const std::string& name,
+                          F&& f,
+                          Self* self,
+                          const HandlerOptions& options) {
+        router_.register_handler(name, std::forward<F>(f), self);
+        apply_options(name, options);
+    }
+
+    // 异步 handler 的第一个参数为 Responder, 见 Router::register_async_handler
+    template <typename F>
+    void register_async_handler(const std::string& name, F&& f) {
+        router_.register_async_handler(name, std::forward<F>(f));
+    }
+
+    template <typename F, typename Self>
+    void register_async_handler(const std::string& name, F&& f, Self* self) {
+        router_.register_async_handler(name, std::forward<F>(f), self);
+    }
+
+    template <typename F>
+    void register_async_handler(const std::string& name, F&& f, const HandlerOptions& options) {
+        router_.register_async_handler(name, std::forward<F>(f));
+        apply_options(name, options);
+    }
+
+    // 流式 handler, 返回逐个产生条目的生成器, 见 Router::register_stream_handler
+    template <typename F>
+    void register_stream_handler(const std::string& name, F&& f) {
+        router_.register_stream_handler(name, std::forward<F>(f));
+    }
+
+#if defined(ASIO_HAS_CO_AWAIT)
+    // 协程 handler, 见 Router::register_coro_handler
+    template <typename F>
+    void register_coro_handler(const std::string& name, F&& f) {
+        router_.register_coro_handler(name, std::forward<F>(f));
+    }
+#endif
+
+    // 设置 SHARED_POOL 的大小, 需在注册使用它的 handler 之前调用;
+    // 未设置时默认 hardware_concurrency 个线程, 队列上限 4096
+    void set_shared_pool(size_t threads, size_t max_queue) {
+        if (shared_pool_) {
+            CLOG_WARN("shared worker pool already created");
+            return;
+        }
+        shared_pool_ = std::make_unique<WorkerPool>("shared", threads, max_queue);
+    }
+
+    // 当前连接数, 不加锁, 可在任意线程调用
+    size_t connection_count() const {
+        size_t count = 0;
+        for (auto& registry : registries_) {
+            count += registry->size();
+        }
+        return count;
+    }
+
+    // 依次在每个 io 线程中对其上的连接调用 f(Connection&), 全部完成后返回。
+    // 每次只占用一个 io 线程处理自己的连接; 需在 io 线程运行期间且不在 io 线程中调用
+    template <typename F>
+    void for_each_connection(F&& f) {
+        for (size_t i = 0; i < registries_.size(); ++i) {
+            std::promise<void> done;
+            asio::post(io_service_pool_.get_io_service(i), [&] {
+                registries_[i]->for_each(f);
+                done.set_value();
+            });
+            done.get_future().wait();
+        }
+    }
+
+    std::vector<WorkerPoolStats> worker_pool_stats() const {
+        std::vector<WorkerPoolStats> result;
+        if (shared_pool_) {
+            result.push_back(shared_pool_->stats());
+        }
+        for (auto& pool : dedicated_pools_) {
+            result.push_back(pool->stats());
+        }
+        return result;
+    }
+
+    // 需在 run() 之前调用: 之后 io 线程建立连接时会并发读取 conn_options_
+    void set_write_batch_limit(WriteBatchLimit limit) {
+        if (router_.frozen()) {
+            throw std::logic_error("set_write_batch_limit: server is running");
+        }
+        conn_options_.write_limit = limit;
+    }
+
+    // 各 io_context 计数器之和, 可在任意线程调用
+    IoStats stats() const {
+        IoStats total;
+        for (auto& stats : io_stats_) {
+            total.add(*stats);
+        }
+        return total;
+    }
+
+    // handler 需在 run() 之前注册完毕, 之后路由表只读
+    void run() {
+        router_.freeze();
+        io_service_pool_.run();
+    }
     void stop() {
         if (!running) {
             return;
         }
-        {
-            std::unique_lock lock(conn_mutex_);
-            stop_check_ = true;
-            clean_cv_.notify_all();
+        if (shared_pool_) {
+            shared_pool_->stop();
+        }
+        for (auto& pool : dedicated_pools_) {
+            pool->stop();
         }
-        clean_thread_.join();
-
         io_service_pool_.stop();
         running = false;
     }
 
 private:
-    void do_accept() {
-        conn_.reset(
-            new Connection(&(io_service_pool_.next_io_service()), &router_, timeout_seconds_));
-        acceptor_.async_accept(conn_->get_socket(), [this](asio::error_code ec) {
+    struct Listener {
+        Listener(asio::io_context& io_service, size_t index, bool round_robin)
+            : acceptor(io_service),
+              index(index),
+              round_robin(round_robin) {}
+
+        tcp::acceptor acceptor;
+        size_t index;                     // acceptor 所在的 io_context
+        bool round_robin;                 // 新连接轮流分配给各 io_context, 否则留在 index
+        std::shared_ptr<Connection> conn; // 正在等待 accept 的连接
+    };
+
+    std::unique_ptr<Listener> listen(unsigned short port, size_t index, bool reuse_port) {
+        auto listener = std::make_unique<Listener>(io_service_pool_.get_io_service(index), index,
+                                                   !reuse_port);
+        tcp::endpoint endpoint(tcp::v4(), port);
+        auto& acceptor = listener->acceptor;
+        acceptor.open(endpoint.protocol());
+        acceptor.set_option(tcp::acceptor::reuse_address(true));
+        if (reuse_port) {
+#if defined(SO_REUSEPORT)
+            using reuse_port_option = asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+            acceptor.set_option(reuse_port_option(true));
+#else
+            throw std::invalid_argument("SO_REUSEPORT is not supported on this platform");
+#endif
+        }
+        acceptor.bind(endpoint);
+        acceptor.listen();
+        return listener;
+    }
+
+    // 在第 index 个 io_context 上新建连接, 用于 accept 或作为迁移目标
+    std::shared_ptr<Connection> make_connection(size_t index) {
+        return std::make_shared<Connection>(
+            &io_service_pool_.get_io_service(index), &router_, conn_options_,
+            io_stats_[index].get(), registries_[index].get(),
+            idle_wheels_.empty() ? nullptr : idle_wheels_[index].get());
+    }
+
+    void do_accept(Listener& listener) {
+        size_t index = listener.round_robin ? io_service_pool_.next_index() : listener.index;
+        listener.conn = make_connection(index);
+        auto& acceptor = listener.acceptor;
+        acceptor.async_accept(listener.conn->get_socket(), [this, &listener](asio::error_code ec) {
             CLOG_TRACE("one client come.");
-            if (!acceptor_.is_open()) {
+            if (!listener.acceptor.is_open()) {
                 return;
             }
             if (ec) {
                 CLOG_WARN("{}: {}", ec.value(), ec.message());
             } else {
-                conn_->set_conn_id(conn_id_);
-                conn_->start();
-                std::lock_guard lock(conn_mutex_);
-                connections_.emplace(conn_id_++, conn_);
-                CLOG_TRACE("establish connection, id:{}.", conn_id_ - 1);
+                int64_t id = conn_id_.fetch_add(1, std::memory_order_relaxed);
+                io_stats_[listener.index]->accepted.fetch_add(1, std::memory_order_relaxed);
+                listener.conn->set_conn_id(id);
+                listener.conn->start();
+                CLOG_TRACE("establish connection, id:{}.", id);
             }
-            do_accept();
+            do_accept(listener);
         });
     }
 
-    void do_clean() {
-        while (!stop_check_) {
-            std::unique_lock lock(conn_mutex_);
-            clean_cv_.wait_for(lock, std::chrono::seconds(check_seconds_));
-            CLOG_TRACE("do_clean: search for connection...");
+    void apply_options(const std::string& name, const HandlerOptions& options) {
+        router_.set_executor(name, make_executor(name, options));
+        router_.set_compression(name, options.compression);
+    }
 
-            for (auto it = connections_.begin(); it != connections_.end();) {
-                if (it->second->has_closed()) {
-                    CLOG_TRACE("clean connection, id:{}", it->first);
-                    it = connections_.erase(it);
-                } else {
-                    ++it;
-                }
+    WorkerPool* make_executor(const std::string& name, const HandlerOptions& options) {
+        switch (options.executor) {
+        case HandlerOptions::Executor::SHARED_POOL:
+            if (!shared_pool_) {
+                set_shared_pool(std::max(1u, std::thread::hardware_concurrency()), 4096);
             }
+            return shared_pool_.get();
+        case HandlerOptions::Executor::DEDICATED_POOL:
+            dedicated_pools_.push_back(
+                std::make_unique<WorkerPool>(name, options.threads, options.max_queue));
+            return dedicated_pools_.back().get();
+        default:
+            return nullptr;
         }
     }
 
     IoServicePool io_service_pool_;
-    asio::ip::tcp::acceptor acceptor_;
-    size_t timeout_seconds_;
+    // 下标与 io_context 对应, 只在对应的 io 线程中访问
+    std::vector<std::unique_ptr<Registry>> registries_;
+    std::vector<std::unique_ptr<IdleWheel>> idle_wheels_;
+    std::unique_ptr<ConnectionBalancer> balancer_;
+    std::vector<std::unique_ptr<Listener>> listeners_;
+    ConnectionOptions conn_options_;
+    std::vector<std::unique_ptr<IoStats>> io_stats_; // 下标与 io_context 对应
     Router router_;
+    std::unique_ptr<WorkerPool> shared_pool_;
+    std::vector<std::unique_ptr<WorkerPool>> dedicated_pools_;
     std::atomic<bool> running{false};
 
-    std::shared_ptr<Connection> conn_;
-    std::unordered_map<int64_t, std::shared_ptr<Connection>> connections_;
-    int64_t conn_id_{0};
-    std::mutex conn_mutex_;
-
-    std::thread clean_thread_;
-    std::condition_variable clean_cv_;
-    size_t check_seconds_;
-    std::atomic<bool> stop_check_{false};
+    std::atomic<int64_t> conn_id_{0};
 
     asio::signal_set signals_;
 };
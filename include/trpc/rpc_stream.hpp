@@ -0,0 +1,285 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "trpc/message.h"
+#include "trpc/rpc_result.hpp"
+
+namespace trpc {
+// 流式调用默认的窗口: 客户端最多缓存这么多个尚未消费的条目, 服务端用完 credit 后暂停发送
+static constexpr uint32_t DEFAULT_STREAM_WINDOW = 256;
+
+// 客户端一个流式调用的状态, 由 RpcClient 的流表与 RpcStream 共同持有。
+// 帧在 io 线程中依次交给 on_frame/on_end; 消费掉的条目累计到半个窗口时, 再向服务端授予同样多的 credit
+class StreamState {
+public:
+    // 发送 credit (STREAM_CREDIT_FLAG) 或 cancel (STREAM_CANCEL_FLAG) 帧, 由 RpcClient 设置
+    using Control = std::function<void(uint32_t flags, uint32_t credits)>;
+
+    explicit StreamState(uint32_t window)
+        : window_(std::max<uint32_t>(window, 1)) {}
+    virtual ~StreamState() = default;
+
+    // frame 的 body 为 (OK, [条目...])
+    virtual void on_frame(RpcResult frame) = 0;
+    // 最终状态; 连接断开时为本地产生的 FAIL
+    virtual void on_end(RpcResult result) = 0;
+
+    void set_control(Control control) { control_ = std::move(control); }
+    uint32_t window() const { return window_; }
+
+protected:
+    // 已消费 n 个条目, 只由消费者 (同一时刻一个线程) 调用
+    void consumed(size_t n) {
+        unacked_ += n;
+        if (unacked_ >= (window_ + 1) / 2) {
+            control_(STREAM_CREDIT_FLAG, static_cast<uint32_t>(std::exchange(unacked_, 0)));
+        }
+    }
+
+    // 通知服务端停止发送, 之后到达的帧被丢弃
+    void cancel() {
+        if (!cancelled_.exchange(true)) {
+            control_(STREAM_CANCEL_FLAG, 0);
+        }
+    }
+
+private:
+    uint32_t window_;
+    size_t unacked_{0};
+    std::atomic<bool> cancelled_{false};
+    Control control_;
+};
+
+// RpcStream 的状态: io 线程解码条目放入队列, 消费者线程取出
+template <typename T>
+class StreamQueue : public StreamState {
+public:
+    using StreamState::StreamState;
+
+    void on_frame(RpcResult frame) override {
+        std::vector<T> items;
+        ResultStatus status = frame.try_as(items);
+        if (!status.ok()) {
+            finish(RpcResult::error(status.message));
+            cancel();
+            return;
+        }
+        std::lock_guard lock(mutex_);
+        if (end_) { // 已取消
+            return;
+        }
+        for (auto& item : items) {
+            items_.push_back(std::move(item));
+        }
+        cv_.notify_one();
+    }
+
+    void on_end(RpcResult result) override { finish(std::move(result)); }
+
+    // timeout 为 0 表示一直等待
+    bool next(T& item, std::chrono::milliseconds timeout) {
+        std::unique_lock lock(mutex_);
+        auto ready = [this] { return !items_.empty() || end_.has_value(); };
+        if (timeout.count() == 0) {
+            cv_.wait(lock, ready);
+        } else if (!cv_.wait_for(lock, timeout, ready)) {
+            end_ = RpcResult::error("deadline exceeded");
+            lock.unlock();
+            cancel();
+            return false;
+        }
+        if (items_.empty()) {
+            return false;
+        }
+        item = std::move(items_.front());
+        items_.pop_front();
+        lock.unlock();
+        consumed(1);
+        return true;
+    }
+
+    ResultStatus status() const {
+        std::lock_guard lock(mutex_);
+        return end_ ? end_->status() : ResultStatus{};
+    }
+
+    // 消费者放弃: 尚未结束时取消
+    void close() {
+        std::unique_lock lock(mutex_);
+        items_.clear();
+        if (end_) {
+            return;
+        }
+        end_ = RpcResult::error("stream cancelled");
+        lock.unlock();
+        cancel();
+    }
+
+private:
+    // 只保留第一个最终状态
+    void finish(RpcResult result) {
+        std::lock_guard lock(mutex_);
+        if (!end_) {
+            end_ = std::move(result);
+        }
+        cv_.notify_one();
+    }
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<T> items_;
+    std::optional<RpcResult> end_; // 有值表示已结束, 剩余的条目仍可取出
+};
+
+// 回调形式的流式调用: 条目在 io 线程中依次交给 on_item
+template <typename T>
+class StreamCallback : public StreamState {
+public:
+    StreamCallback(uint32_t window,
+                   std::function<bool(T)> on_item,
+                   std::function<void(ResultStatus)> on_done)
+        : StreamState(window),
+          on_item_(std::move(on_item)),
+          on_done_(std::move(on_done)) {}
+
+    void on_frame(RpcResult frame) override {
+        if (finished_) {
+            return;
+        }
+        std::vector<T> items;
+        ResultStatus status = frame.try_as(items);
+        if (!status.ok()) {
+            stop(status);
+            return;
+        }
+        for (auto& item : items) {
+            bool more;
+            try {
+                more = on_item_(std::move(item));
+            } catch (const std::exception& e) {
+                stop({FuncResultCode::FAIL, e.what()});
+                return;
+            }
+            if (!more) {
+                stop({FuncResultCode::FAIL, "stream cancelled"});
+                return;
+            }
+        }
+        consumed(items.size());
+    }
+
+    void on_end(RpcResult result) override {
+        if (!finished_.exchange(true)) {
+            on_done_(result.status());
+        }
+    }
+
+private:
+    void stop(ResultStatus status) {
+        if (!finished_.exchange(true)) {
+            cancel();
+            on_done_(status);
+        }
+    }
+
+    std::function<bool(T)> on_item_;
+    std::function<void(ResultStatus)> on_done_;
+    std::atomic<bool> finished_{false};
+};
+
+// 流式调用的结果, 只能移动。用 next() 或 range-for 逐个取出条目, 条目到达后即可取出,
+// 不必等待整个结果; 提前销毁时通知服务端停止发送。不能比创建它的 RpcClient 活得更久
+template <typename T>
+class RpcStream {
+public:
+    RpcStream(std::shared_ptr<StreamQueue<T>> state, std::chrono::milliseconds timeout)
+        : state_(std::move(state)),
+          timeout_(timeout) {}
+
+    RpcStream(RpcStream&&) noexcept = default;
+    RpcStream& operator=(RpcStream&& other) noexcept {
+        if (this != &other) {
+            close();
+            state_ = std::move(other.state_);
+            timeout_ = other.timeout_;
+        }
+        return *this;
+    }
+
+    ~RpcStream() { close(); }
+
+    // 取出下一个条目; 流结束、失败或等待超过 timeout (0 表示不限) 时返回 false, 原因见 status()
+    bool next(T& item) { return state_->next(item, timeout_); }
+
+    // 结束后的最终状态, message 在 RpcStream 销毁前有效
+    ResultStatus status() const { return state_->status(); }
+
+    // 输入迭代器, 流失败时抛出 std::logic_error(失败原因)
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = T*;
+        using reference = T&;
+
+        iterator() = default;
+        explicit iterator(RpcStream* stream)
+            : stream_(stream) {
+            advance();
+        }
+
+        T& operator*() { return item_; }
+        T* operator->() { return &item_; }
+        iterator& operator++() {
+            advance();
+            return *this;
+        }
+        bool operator==(const iterator& other) const { return stream_ == other.stream_; }
+        bool operator!=(const iterator& other) const { return stream_ != other.stream_; }
+
+    private:
+        void advance() {
+            if (stream_->next(item_)) {
+                return;
+            }
+            ResultStatus status = std::exchange(stream_, nullptr)->status();
+            if (!status.ok()) {
+                throw std::logic_error(std::string(status.message));
+            }
+        }
+
+        RpcStream* stream_{nullptr};
+        T item_{};
+    };
+
+    iterator begin() { return iterator(this); }
+    iterator end() { return iterator(); }
+
+private:
+    void close() {
+        if (state_) {
+            state_->close();
+        }
+    }
+
+    std::shared_ptr<StreamQueue<T>> state_;
+    std::chrono::milliseconds timeout_;
+};
+} // namespace trpc
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace trpc {
+// 运行时计数器，均使用 relaxed 原子操作，只用于观测。
+// 服务端每个 io_context 各有一份, 避免各 io 线程争用同一缓存行, 读取时再汇总
+struct alignas(64) IoStats {
+    std::atomic<uint64_t> write_batches{0};  // async_write 次数
+    std::atomic<uint64_t> frames_written{0}; // 写出的帧数
+    std::atomic<uint64_t> bytes_written{0};
+    std::atomic<uint64_t> read_batches{0}; // async_read_some 完成次数
+    std::atomic<uint64_t> frames_read{0};
+    // 服务端: 超过 deadline 未执行而丢弃的请求; 客户端: 超时失败的调用
+    std::atomic<uint64_t> expired{0};
+    std::atomic<uint64_t> accepted{0};   // 服务端接受的连接数
+    std::atomic<uint64_t> migrations{0}; // 迁移到其他 io_context 的连接数
+    // 帧体压缩, 见 compression.hpp。耗时为所在线程的 CPU 时间 (不含被抢占、等待的时间),
+    // 包括压缩后没有变小而放弃的尝试和解压失败的帧
+    std::atomic<uint64_t> compressed_frames{0};
+    std::atomic<uint64_t> compress_bytes_in{0}; // 压缩成功的帧压缩前后的 body 长度
+    std::atomic<uint64_t> compress_bytes_out{0};
+    std::atomic<uint64_t> compress_cpu_ns{0};
+    std::atomic<uint64_t> decompressed_frames{0}; // 解压成功的帧
+    std::atomic<uint64_t> decompress_failures{0}; // 损坏而无法解压的帧
+    std::atomic<uint64_t> decompress_cpu_ns{0};
+
+    IoStats() = default;
+    // 复制时读取各计数器的当前值, 用于汇总
+    IoStats(const IoStats& other) { add(other); }
+    IoStats& operator=(const IoStats&) = delete;
+
+    void add(const IoStats& other) {
+        auto add_to = [](std::atomic<uint64_t>& to, const std::atomic<uint64_t>& from) {
+            to.fetch_add(from.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        };
+        add_to(write_batches, other.write_batches);
+        add_to(frames_written, other.frames_written);
+        add_to(bytes_written, other.bytes_written);
+        add_to(read_batches, other.read_batches);
+        add_to(frames_read, other.frames_read);
+        add_to(expired, other.expired);
+        add_to(accepted, other.accepted);
+        add_to(migrations, other.migrations);
+        add_to(compressed_frames, other.compressed_frames);
+        add_to(compress_bytes_in, other.compress_bytes_in);
+        add_to(compress_bytes_out, other.compress_bytes_out);
+        add_to(compress_cpu_ns, other.compress_cpu_ns);
+        add_to(decompressed_frames, other.decompressed_frames);
+        add_to(decompress_failures, other.decompress_failures);
+        add_to(decompress_cpu_ns, other.decompress_cpu_ns);
+    }
+
+    void on_read_batch(uint64_t frames) {
+        read_batches.fetch_add(1, std::memory_order_relaxed);
+        frames_read.fetch_add(frames, std::memory_order_relaxed);
+    }
+
+    void on_write_batch(uint64_t frames, uint64_t bytes) {
+        write_batches.fetch_add(1, std::memory_order_relaxed);
+        frames_written.fetch_add(frames, std::memory_order_relaxed);
+        bytes_written.fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void on_compress(bool compressed, uint64_t bytes_in, uint64_t bytes_out, uint64_t cpu_ns) {
+        if (compressed) {
+            compressed_frames.fetch_add(1, std::memory_order_relaxed);
+            compress_bytes_in.fetch_add(bytes_in, std::memory_order_relaxed);
+            compress_bytes_out.fetch_add(bytes_out, std::memory_order_relaxed);
+        }
+        compress_cpu_ns.fetch_add(cpu_ns, std::memory_order_relaxed);
+    }
+
+    void on_decompress(bool ok, uint64_t cpu_ns) {
+        if (ok) {
+            decompressed_frames.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            decompress_failures.fetch_add(1, std::memory_order_relaxed);
+        }
+        decompress_cpu_ns.fetch_add(cpu_ns, std::memory_order_relaxed);
+    }
+
+    // 压缩节省的字节数
+    uint64_t bytes_saved() const {
+        return compress_bytes_in.load(std::memory_order_relaxed) -
+               compress_bytes_out.load(std::memory_order_relaxed);
+    }
+
+    double frames_per_read() const {
+        uint64_t batches = read_batches.load(std::memory_order_relaxed);
+        return batches == 0 ? 0.0
+                            : static_cast<double>(frames_read.load(std::memory_order_relaxed)) /
+                                  static_cast<double>(batches);
+    }
+
+    // 平均每次写操作合并的帧数，用于确认批量写是否生效
+    double frames_per_write() const {
+        uint64_t batches = write_batches.load(std::memory_order_relaxed);
+        return batches == 0 ? 0.0
+                            : static_cast<double>(frames_written.load(std::memory_order_relaxed)) /
+                                  static_cast<double>(batches);
+    }
+};
+} // namespace trpc
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "asio.hpp"
+#include "asio/detail/noncopyable.hpp"
+
+namespace trpc {
+// 哈希时间轮，跟踪同一 io_context 上各连接的空闲超时，只能在该 io_context 的线程中使用。
+// 活跃时连接只需记录 now() (见 T::last_active), 不需要操作定时器;
+// 每个 tick 只检查到期桶中的连接: 已关闭的丢弃, 期间活跃过的按新的期限重新放入对应的桶,
+// 真正空闲的调用 T::on_idle_timeout(), 其返回 false (仍有未完成的工作) 时再等一个周期。
+// T 需提供: bool has_closed() const; uint64_t last_active() const; bool on_idle_timeout();
+template <typename T>
+class TimingWheel : asio::noncopyable {
+public:
+    TimingWheel(asio::io_context& io_service, std::chrono::milliseconds tick, size_t timeout_ticks)
+        : timer_(io_service),
+          tick_(tick),
+          timeout_ticks_(std::max<size_t>(timeout_ticks, 1)),
+          buckets_(timeout_ticks_ + 1) {
+        schedule();
+    }
+
+    ~TimingWheel() { timer_.cancel(); }
+
+    // 当前 tick 数，连接在有活动时记录
+    uint64_t now() const { return current_tick_; }
+
+    void add(const std::shared_ptr<T>& entry) { insert(entry, current_tick_ + timeout_ticks_); }
+
+    size_t timeout_ticks() const { return timeout_ticks_; }
+
+private:
+    void insert(const std::shared_ptr<T>& entry, uint64_t deadline) {
+        buckets_[deadline % buckets_.size()].emplace_back(entry);
+    }
+
+    void schedule() {
+        timer_.expires_after(tick_);
+        timer_.async_wait([this](asio::error_code ec) {
+            if (ec) {
+                return;
+            }
+            on_tick();
+            schedule();
+        });
+    }
+
+    void on_tick() {
+        ++current_tick_;
+        // 重新插入的期限都大于 current_tick_, 不会落回当前桶
+        auto expiring = std::move(buckets_[current_tick_ % buckets_.size()]);
+        buckets_[current_tick_ % buckets_.size()].clear();
+        for (auto& weak : expiring) {
+            auto entry = weak.lock();
+            if (!entry || entry->has_closed()) {
+                continue;
+            }
+            uint64_t deadline = entry->last_active() + timeout_ticks_;
+            if (deadline > current_tick_) {
+                insert(entry, deadline);
+            } else if (!entry->on_idle_timeout()) {
+                insert(entry, current_tick_ + timeout_ticks_);
+            }
+        }
+    }
+
+    asio::steady_timer timer_;
+    std::chrono::milliseconds tick_;
+    size_t timeout_ticks_;
+    uint64_t current_tick_{0};
+    std::vector<std::vector<std::weak_ptr<T>>> buckets_;
+};
+} // namespace trpc
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#if __has_include(<span>)
+#include <span>
+#endif
+
+#include "msgpack.hpp"
+#include "trpc/meta_util.hpp"
+
+namespace trpc {
+// 数值数组 (TypedArray<T>, ArrayView<T>, C++20 的 std::span<T>) 整体编码为一个 msgpack ext 对象,
+// 而不是逐个元素编码: ext 类型为 TYPED_ARRAY_EXT, 内容为
+//   [uint8 元素类型][uint8 pad][pad 个 0][小端序的元素]
+// pad 使元素相对 ext 对象的起始位置按 8 字节对齐。解码为 TypedArray<T> 只需一次 memcpy,
+// 解码为 ArrayView<T> 不拷贝。需要显式使用这些类型: std::vector<T> 仍按 msgpack 的默认方式
+// 逐个元素编码, 与旧版本及其他 msgpack 实现兼容; 只有双方都使用本头文件时才能解码 ext 对象。
+// T 为 int8_t, (u)int16_t, (u)int32_t, (u)int64_t, float, double; char/unsigned char 的数组
+// 由 msgpack 编码为 BIN, 不在此列
+static constexpr int8_t TYPED_ARRAY_EXT = 0x41;
+
+template <typename T>
+struct IsTypedArrayElement
+    : std::bool_constant<std::is_same_v<T, int8_t> || std::is_same_v<T, int16_t> ||
+                         std::is_same_v<T, uint16_t> || std::is_same_v<T, int32_t> ||
+                         std::is_same_v<T, uint32_t> || std::is_same_v<T, int64_t> ||
+                         std::is_same_v<T, uint64_t> || std::is_same_v<T, float> ||
+                         std::is_same_v<T, double>> {};
+
+namespace typed_array {
+static constexpr bool HOST_LITTLE_ENDIAN = __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+static constexpr size_t ALIGNMENT = 8;
+
+// 高 4 位为种类 (0 无符号整数, 1 有符号整数, 2 浮点数), 低 4 位为元素大小
+template <typename T>
+constexpr uint8_t tag() {
+    uint8_t kind = std::is_floating_point_v<T> ? 2 : std::is_signed_v<T> ? 1 : 0;
+    return static_cast<uint8_t>(kind << 4 | sizeof(T));
+}
+
+template <typename T>
+T byteswap(T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    std::reverse(bytes, bytes + sizeof(T));
+    std::memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+// 按小端序读取第 i 个元素, bytes 不要求对齐
+template <typename T>
+T load(const char* bytes, size_t i) {
+    T value;
+    std::memcpy(&value, bytes + i * sizeof(T), sizeof(T));
+    return HOST_LITTLE_ENDIAN ? value : byteswap(value);
+}
+
+template <typename T>
+void copy_out(T* out, const char* bytes, size_t size) {
+    if (size == 0) {
+        return;
+    }
+    if constexpr (HOST_LITTLE_ENDIAN) {
+        std::memcpy(out, bytes, size * sizeof(T));
+    } else {
+        for (size_t i = 0; i < size; ++i) {
+            out[i] = load<T>(bytes, i);
+        }
+    }
+}
+
+// ext 头的长度 (类型字节之前的部分加上类型字节)
+inline size_t ext_header_size(size_t len) {
+    switch (len) {
+    case 1:
+    case 2:
+    case 4:
+    case 8:
+    case 16:
+        return 2;
+    default:
+        return len < 0x100 ? 3 : len < 0x10000 ? 4 : 6;
+    }
+}
+
+// host_order 为 false 时 data 已是小端序
+template <typename Stream, typename T>
+void pack(msgpack::packer<Stream>& o, const T* data, size_t size, bool host_order = true) {
+    size_t bytes = size * sizeof(T);
+    if (bytes > UINT32_MAX - 2 - ALIGNMENT) {
+        throw std::length_error("typed array too long");
+    }
+    size_t pad = 0;
+    while (pad + 1 < ALIGNMENT && (ext_header_size(2 + pad + bytes) + 2 + pad) % ALIGNMENT != 0) {
+        ++pad;
+    }
+    char head[2 + ALIGNMENT] = {};
+    head[0] = static_cast<char>(tag<T>());
+    head[1] = static_cast<char>(pad);
+    o.pack_ext(2 + pad + bytes, TYPED_ARRAY_EXT);
+    o.pack_ext_body(head, static_cast<uint32_t>(2 + pad));
+    if (bytes == 0) {
+        return;
+    }
+    if (HOST_LITTLE_ENDIAN || !host_order) {
+        o.pack_ext_body(reinterpret_cast<const char*>(data), static_cast<uint32_t>(bytes));
+        return;
+    }
+    for (size_t i = 0; i < size; ++i) {
+        T value = byteswap(data[i]);
+        o.pack_ext_body(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+}
+
+// o 为元素类型为 T 的数组时返回元素的起始位置, 并设置元素个数; 否则抛出 msgpack::type_error
+template <typename T>
+const char* elements(const msgpack::object& o, size_t& size) {
+    if (o.type != msgpack::type::EXT || o.via.ext.type() != TYPED_ARRAY_EXT ||
+        o.via.ext.size < 2) {
+        throw msgpack::type_error();
+    }
+    const char* payload = o.via.ext.data();
+    size_t pad = static_cast<uint8_t>(payload[1]);
+    if (static_cast<uint8_t>(payload[0]) != tag<T>() || o.via.ext.size < 2 + pad ||
+        (o.via.ext.size - 2 - pad) % sizeof(T) != 0) {
+        throw msgpack::type_error();
+    }
+    size = (o.via.ext.size - 2 - pad) / sizeof(T);
+    return payload + 2 + pad;
+}
+} // namespace typed_array
+
+// 整体编码的 std::vector<T>, 可直接替换 std::vector<T> 作为参数或结果类型。
+// 解码时同时接受整体编码与逐个元素编码的数组
+template <typename T>
+class TypedArray : public std::vector<T> {
+    static_assert(IsTypedArrayElement<T>::value, "unsupported typed array element");
+
+public:
+    using std::vector<T>::vector;
+    TypedArray() = default;
+    TypedArray(std::vector<T> values)
+        : std::vector<T>(std::move(values)) {}
+};
+
+// 数值数组的只读视图。解码得到时直接指向接收缓冲区, 与 std::string_view 参数一样只在调用期间
+// (或 RpcResult 销毁前) 有效; 也可以包装调用方的内存用于发送, 省去先拷贝到 std::vector。
+// 元素在帧中不一定按 T 对齐, 因此按值读取; aligned() 时 data() 可以直接使用
+template <typename T>
+class ArrayView {
+    static_assert(IsTypedArrayElement<T>::value, "unsupported typed array element");
+
+public:
+    class iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = T;
+
+        iterator(const ArrayView* view, size_t index)
+            : view_(view),
+              index_(index) {}
+
+        T operator*() const { return (*view_)[index_]; }
+        iterator& operator++() {
+            ++index_;
+            return *this;
+        }
+        bool operator==(const iterator& other) const { return index_ == other.index_; }
+        bool operator!=(const iterator& other) const { return index_ != other.index_; }
+
+    private:
+        const ArrayView* view_;
+        size_t index_;
+    };
+
+    ArrayView() = default;
+    ArrayView(const T* data, size_t size)
+        : bytes_(reinterpret_cast<const char*>(data)),
+          size_(size),
+          host_order_(true) {}
+    ArrayView(const std::vector<T>& values)
+        : ArrayView(values.data(), values.size()) {}
+
+    // 指向小端序的元素
+    static ArrayView from_wire(const char* bytes, size_t size) {
+        ArrayView view;
+        view.bytes_ = bytes;
+        view.size_ = size;
+        view.host_order_ = typed_array::HOST_LITTLE_ENDIAN;
+        return view;
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    T operator[](size_t i) const {
+        T value;
+        std::memcpy(&value, bytes_ + i * sizeof(T), sizeof(T));
+        return host_order_ ? value : typed_array::byteswap(value);
+    }
+
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, size_); }
+
+    bool aligned() const {
+        return host_order_ && reinterpret_cast<uintptr_t>(bytes_) % alignof(T) == 0;
+    }
+
+    // aligned() 时返回元素指针, 否则为 nullptr
+    const T* data() const { return aligned() ? reinterpret_cast<const T*>(bytes_) : nullptr; }
+
+    void copy_to(T* out) const {
+        if (host_order_) {
+            if (size_ != 0) {
+                std::memcpy(out, bytes_, size_ * sizeof(T));
+            }
+            return;
+        }
+        for (size_t i = 0; i < size_; ++i) {
+            out[i] = (*this)[i];
+        }
+    }
+
+    std::vector<T> to_vector() const {
+        std::vector<T> values(size_);
+        copy_to(values.data());
+        return values;
+    }
+
+    // 元素所在的原始字节及其字节序, 供编码使用
+    const char* raw_bytes() const { return bytes_; }
+    bool host_order() const { return host_order_; }
+
+private:
+    const char* bytes_{nullptr};
+    size_t size_{0};
+    bool host_order_{true};
+};
+
+template <typename T>
+struct IsBorrowed<ArrayView<T>> : std::true_type {};
+} // namespace trpc
+
+namespace msgpack {
+MSGPACK_API_VERSION_NAMESPACE(MSGPACK_DEFAULT_API_NS) {
+namespace adaptor {
+
+template <typename T>
+struct pack<trpc::TypedArray<T>> {
+    template <typename Stream>
+    msgpack::packer<Stream>& operator()(msgpack::packer<Stream>& o,
+                                        const trpc::TypedArray<T>& v) const {
+        trpc::typed_array::pack(o, v.data(), v.size());
+        return o;
+    }
+};
+
+template <typename T>
+struct convert<trpc::TypedArray<T>> {
+    const msgpack::object& operator()(const msgpack::object& o, trpc::TypedArray<T>& v) const {
+        if (o.type == msgpack::type::ARRAY) {
+            v.resize(o.via.array.size);
+            for (uint32_t i = 0; i < o.via.array.size; ++i) {
+                o.via.array.ptr[i].convert(v[i]);
+            }
+            return o;
+        }
+        size_t size = 0;
+        const char* bytes = trpc::typed_array::elements<T>(o, size);
+        v.resize(size);
+        trpc::typed_array::copy_out(v.data(), bytes, size);
+        return o;
+    }
+};
+
+template <typename T>
+struct pack<trpc::ArrayView<T>> {
+    template <typename Stream>
+    msgpack::packer<Stream>& operator()(msgpack::packer<Stream>& o,
+                                        const trpc::ArrayView<T>& v) const {
+        trpc::typed_array::pack(o, reinterpret_cast<const T*>(v.raw_bytes()), v.size(),
+                                v.host_order());
+        return o;
+    }
+};
+
+// 解码结果引用 o 所在的缓冲区, 需以 reference_all 解码 (见 msgpack_codec::unpack)
+template <typename T>
+struct convert<trpc::ArrayView<T>> {
+    const msgpack::object& operator()(const msgpack::object& o, trpc::ArrayView<T>& v) const {
+        size_t size = 0;
+        const char* bytes = trpc::typed_array::elements<T>(o, size);
+        v = trpc::ArrayView<T>::from_wire(bytes, size);
+        return o;
+    }
+};
+
+#if defined(__cpp_lib_span)
+template <typename T, std::size_t N>
+struct pack<std::span<T, N>,
+            std::enable_if_t<trpc::IsTypedArrayElement<std::remove_const_t<T>>::value>> {
+    template <typename Stream>
+    msgpack::packer<Stream>& operator()(msgpack::packer<Stream>& o, std::span<T, N> v) const {
+        trpc::typed_array::pack(o, v.data(), v.size());
+        return o;
+    }
+};
+#endif
+
+} // namespace adaptor
+} // MSGPACK_API_VERSION_NAMESPACE(MSGPACK_DEFAULT_API_NS)
+} // namespace msgpack
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "asio/detail/noncopyable.hpp"
+#include "clog/clog.h"
+
+namespace trpc {
+struct WorkerPoolStats {
+    std::string name;
+    size_t threads;
+    size_t queue_depth;
+    uint64_t executed;
+    uint64_t rejected;
+};
+
+// 有界任务队列 + 固定数量的工作线程，用于把耗时的 handler 从 io 线程上移走。
+// 队列满时 try_post 直接拒绝，由调用者返回错误，避免请求无限堆积。
+class WorkerPool : asio::noncopyable {
+public:
+    using Task = std::function<void()>;
+
+    WorkerPool(std::string name, size_t threads, size_t max_queue)
+        : name_(std::move(name)),
+          max_queue_(max_queue) {
+        if (threads == 0) {
+            threads = 1;
+        }
+        for (size_t i = 0; i < threads; ++i) {
+            threads_.emplace_back([this] { run(); });
+        }
+        CLOG_INFO("worker pool {} running with {} threads, max queue {}", name_, threads,
+                  max_queue_);
+    }
+
+    ~WorkerPool() { stop(); }
+
+    bool try_post(Task task) {
+        {
+            std::lock_guard lock(mutex_);
+            if (stopped_ || queue_.size() >= max_queue_) {
+                rejected_.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            queue_.emplace_back(std::move(task));
+        }
+        cv_.notify_one();
+        return true;
+    }
+
+    // 丢弃尚未执行的任务并等待工作线程退出
+    void stop() {
+        {
+            std::lock_guard lock(mutex_);
+            if (stopped_) {
+                return;
+            }
+            stopped_ = true;
+            queue_.clear();
+        }
+        cv_.notify_all();
+        for (auto& t : threads_) {
+            if (t.joinable()) {
+                t.join();
+            }
+        }
+    }
+
+    WorkerPoolStats stats() const {
+        std::lock_guard lock(mutex_);
+        return {name_, threads_.size(), queue_.size(), executed_.load(std::memory_order_relaxed),
+                rejected_.load(std::memory_order_relaxed)};
+    }
+
+private:
+    void run() {
+        while (true) {
+            Task task;
+            {
+                std::unique_lock lock(mutex_);
+                cv_.wait(lock, [this] { return stopped_ || !queue_.empty(); });
+                if (stopped_) {
+                    return;
+                }
+                task = std::move(queue_.front());
+                queue_.pop_front();
+            }
+            task();
+            executed_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    std::string name_;
+    size_t max_queue_;
+    std::vector<std::thread> threads_;
+    std::deque<Task> queue_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    bool stopped_{false};
+    std::atomic<uint64_t> executed_{0};
+    std::atomic<uint64_t> rejected_{0};
+};
+} // namespace trpc
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "asio.hpp"
+#include "trpc/buffer.hpp"
+
+namespace trpc {
+// 单次 gather write 的上限: 字节数与帧数 (即 iovec 个数)
+struct WriteBatchLimit {
+    size_t max_bytes = 1024 * 1024;
+    size_t max_frames = 64;
+};
+
+// WriteQueue 中一批帧的 iovec 列表的只读视图, 满足 ConstBufferSequence。
+// async_write 会把缓冲区序列拷贝进操作状态, 拷贝视图只复制两个指针, 不像 std::vector 那样分配内存;
+// 它指向的列表在本批写完 (finish_batch) 之前不会改变
+class BatchBuffers {
+public:
+    using value_type = asio::const_buffer;
+    using const_iterator = const asio::const_buffer*;
+
+    BatchBuffers(const_iterator first, const_iterator last)
+        : first_(first),
+          last_(last) {}
+
+    const_iterator begin() const { return first_; }
+    const_iterator end() const { return last_; }
+
+private:
+    const_iterator first_;
+    const_iterator last_;
+};
+
+// 待发送帧队列: 每次取出队首的若干帧组成一次 gather write，写完后整体回收。
+// 非线程安全，由使用者加锁或保证单线程访问。
+class WriteQueue {
+public:
+    explicit WriteQueue(WriteBatchLimit limit = {})
+        : limit_(limit) {}
+
+    void set_limit(WriteBatchLimit limit) { limit_ = limit; }
+
+    void push(Buffer frame) {
+        pending_bytes_ += frame.size();
+        pending_.emplace_back(std::move(frame));
+    }
+
+    bool has_pending() const { return head_ < pending_.size(); }
+    // 尚未开始发送的字节数
+    size_t pending_bytes() const { return pending_bytes_; }
+    bool writing() const { return !writing_.empty(); }
+
+    // 将队首若干帧 (至少一帧) 移入发送中列表，返回对应的 iovec 列表
+    BatchBuffers next_batch() {
+        size_t frames = 0;
+        batch_bytes_ = 0;
+        while (head_ + frames < pending_.size()) {
+            size_t size = pending_[head_ + frames].size();
+            if (frames > 0 &&
+                (frames >= limit_.max_frames || batch_bytes_ + size > limit_.max_bytes)) {
+                break;
+            }
+            batch_bytes_ += size;
+            ++frames;
+        }
+        buffers_.clear();
+        for (size_t i = head_; i < head_ + frames; ++i) {
+            buffers_.emplace_back(asio::buffer(pending_[i].data(), pending_[i].size()));
+            writing_.emplace_back(std::move(pending_[i]));
+        }
+        head_ += frames;
+        pending_bytes_ -= batch_bytes_;
+        compact();
+        return BatchBuffers(buffers_.data(), buffers_.data() + buffers_.size());
+    }
+
+    size_t batch_frames() const { return writing_.size(); }
+    size_t batch_bytes() const { return batch_bytes_; }
+
+    // 本批写完成，帧缓冲区交还给 pool
+    void finish_batch(BufferPool& pool) {
+        for (auto& frame : writing_) {
+            pool.release(std::move(frame));
+        }
+        writing_.clear();
+    }
+
+private:
+    static constexpr size_t MIN_COMPACT_FRAMES = 64;
+
+    // 已取出的帧只前移 head_, 不逐批移动剩余的帧; 队列取空时清空,
+    // 积压很深时等已取出的部分过半再整体前移一次, 均摊为 O(1)
+    void compact() {
+        if (head_ == pending_.size()) {
+            pending_.clear();
+            head_ = 0;
+        } else if (head_ >= MIN_COMPACT_FRAMES && head_ * 2 >= pending_.size()) {
+            pending_.erase(pending_.begin(), pending_.begin() + head_);
+            head_ = 0;
+        }
+    }
+
+    WriteBatchLimit limit_;
+    std::vector<Buffer> pending_; // [head_, size) 为尚未发送的帧
+    size_t head_{0};
+    std::vector<Buffer> writing_;
+    std::vector<asio::const_buffer> buffers_;
+    size_t batch_bytes_{0};
+    size_t pending_bytes_{0};
+};
+} // namespace trpc
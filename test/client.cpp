@@ -1,5 +1,6 @@
 #include "clog/clog.h"
 #include "trpc/rpc_client.hpp"
+#include "trpc/rpc_client_pool.hpp"
 
 struct Fun {
     int id;
@@ -9,6 +10,14 @@ struct Fun {
     MSGPACK_DEFINE(id, name, age);
 };
 
+struct Point {
+    double x;
+    double y;
+
+    using raw_fields = std::tuple<double, double>;
+    MSGPACK_DEFINE(x, y);
+};
+
 int main() {
     trpc::RpcClient client("127.0.0.1", 6666);
     try {
@@ -29,6 +38,20 @@ int main() {
         auto res = client.call<double>("ff", 1, 2);
         clog::info("ret: {}", res);
         client.call<void>("print");
+        auto sum = client.call<int, 1000>("delay_add", 1, 2);
+        clog::info("delay_add: {}", sum);
+        // 预先计算函数 id, 调用时不再计算哈希
+        static constexpr trpc::FuncId HELLO = trpc::func_id("hello");
+        ret = client.call<int, 1000>(HELLO, 5, 6);
+        clog::info("hello by id: {}", ret);
+        auto bytes = client.call<size_t, 1000>("byte_count", std::string(4096, 'x'));
+        clog::info("byte_count: {}", bytes);
+        // 可平凡拷贝的参数与结果按内存布局传输, 不经过 msgpack
+        auto p = client.call<Point, 1000>(trpc::RawCodec{}, "move_point", Point{1, 2}, 0.5);
+        clog::info("raw move_point: ({}, {})", p.x, p.y);
+        // TypedArray 整体编码, 服务端可以用 ArrayView 不拷贝地读取
+        auto total = client.call<double, 1000>("sum", trpc::TypedArray<float>(1000, 0.5f));
+        clog::info("sum: {}", total);
 
         // async call
         std::future<trpc::RpcResult> res_future = client.async_call("get_dummy", 1, 2.0);
@@ -40,6 +63,39 @@ int main() {
             clog::info("result: {}", result);
         }
 
+        // 不抛异常地取结果, message 在 RpcResult 销毁前有效
+        trpc::RpcResult missing = client.async_call("no_such_function").get();
+        int value = 0;
+        if (auto result_status = missing.try_as(value); !result_status) {
+            clog::info("try_as failed as expected: {}", result_status.message);
+        }
+
+        // 开启压缩: 不小于 1KB 的请求体被压缩, 服务端也可以压缩响应
+        client.set_compression({true, 1024});
+        auto text = client.call<std::string, 1000>("repeat", std::string("compress me! "), 1000);
+        bytes = client.call<size_t, 1000>("byte_count", std::string(64 * 1024, 'x'));
+        clog::info("repeat: {} bytes, byte_count: {}, bytes saved: {}", text.size(), bytes,
+                   client.stats().bytes_saved());
+
+        // 流式调用: 条目分多帧到达, 边收边处理; 也可以用 stream_call 在 io 线程中回调
+        long count_total = 0;
+        for (int i : client.stream<int>("count_up", 0, 100000)) {
+            count_total += i;
+        }
+        clog::info("count_up total: {}", count_total);
+
+    } catch (const std::exception& e) {
+        clog::error("{}", e.what());
+    }
+
+    // 4 个连接分布在 2 个 io 线程上
+    trpc::RpcClientPool pool("127.0.0.1", 6666, 4, 2);
+    try {
+        if (!pool.connect()) {
+            throw std::runtime_error("cannot connect to host");
+        }
+        auto ret = pool.call<int, 1000>("hello", 3, 4);
+        clog::info("pool ret: {}", ret);
     } catch (const std::exception& e) {
         clog::error("{}", e.what());
     }
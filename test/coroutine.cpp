@@ -0,0 +1,60 @@
+// C++20 协程示例 (需 -DTRPC_ENABLE_COROUTINE=ON):
+// backend 提供 add, frontend 的协程 handler sum4 通过 co_call 并发调用两次 backend
+// (用 asio 的 awaitable 运算符 && 同时等待两个调用), 客户端再以协程方式调用 frontend。
+#include <thread>
+#include <utility>
+
+#include "asio/experimental/awaitable_operators.hpp"
+#include "clog/clog.h"
+#include "trpc/rpc_client.hpp"
+#include "trpc/rpc_server.hpp"
+
+int main() {
+    clog::setLogLevel(clog::LogLevel::INFO);
+
+    trpc::RpcServer backend(6667, 1);
+    backend.register_handler("add", [](int a, int b) { return a + b; });
+    std::thread backend_thread([&backend] { backend.run(); });
+
+    trpc::RpcClient downstream("127.0.0.1", 6667);
+    if (!downstream.connect()) {
+        clog::error("cannot connect to backend");
+        return 1;
+    }
+
+    trpc::RpcServer frontend(6668, 2);
+    frontend.register_coro_handler(
+        "sum4", [&downstream](int a, int b, int c, int d) -> asio::awaitable<int> {
+            using namespace asio::experimental::awaitable_operators;
+            // 两个请求同时发出, 都返回后继续
+            auto [ab, cd] = co_await (downstream.co_call<int>("add", a, b) &&
+                                      downstream.co_call<int>("add", c, d));
+            co_return ab + cd;
+        });
+    std::thread frontend_thread([&frontend] { frontend.run(); });
+
+    trpc::RpcClient client("127.0.0.1", 6668);
+    if (!client.connect()) {
+        clog::error("cannot connect to frontend");
+        return 1;
+    }
+    std::promise<void> done;
+    asio::co_spawn(
+        client.get_executor(),
+        [&client]() -> asio::awaitable<void> {
+            int sum = co_await client.co_call<int>("sum4", 1, 2, 3, 4);
+            clog::info("sum4: {}", sum);
+            try {
+                co_await client.co_call<int>("not_exist");
+            } catch (const std::exception& e) {
+                clog::info("expected error: {}", e.what());
+            }
+        },
+        [&done](std::exception_ptr) { done.set_value(); });
+    done.get_future().wait();
+
+    frontend.stop();
+    backend.stop();
+    frontend_thread.join();
+    backend_thread.join();
+}
@@ -1,6 +1,8 @@
 #include <iostream>
 #include <map>
+#include <optional>
 #include <string>
+#include <thread>
 #include <tuple>
 
 #include "clog/clog.h"
@@ -32,6 +34,57 @@ Fun get_fun() { return Fun{1, "xiaoqie", 20}; }
 
 std::string get_fun_name(const Fun& f) { return f.name; }
 
+// std::string_view 参数直接指向接收缓冲区, 不拷贝, 只在调用期间有效
+size_t byte_count(std::string_view data) { return data.size(); }
+
+// 参数与结果都可平凡拷贝且列出了字段, 客户端也可以用 RawCodec 调用
+struct Point {
+    double x;
+    double y;
+
+    using raw_fields = std::tuple<double, double>;
+    MSGPACK_DEFINE(x, y);
+};
+
+Point move_point(Point p, double d) { return Point{p.x + d, p.y + d}; }
+
+// 数值数组整体编码, ArrayView 参数直接指向接收缓冲区, 只在调用期间有效
+double sum(trpc::ArrayView<float> values) {
+    double total = 0;
+    for (float v : values) {
+        total += v;
+    }
+    return total;
+}
+
+// 结果较大且重复度高, 适合压缩
+std::string repeat(const std::string& text, int times) {
+    std::string result;
+    for (int i = 0; i < times; ++i) {
+        result += text;
+    }
+    return result;
+}
+
+// 流式 handler: 返回生成器, 每次调用产生一个条目, 返回 std::nullopt 表示结束。
+// 服务端按客户端授予的 credit 逐步调用, 不必一次生成全部结果
+auto count_up(int from, int to) {
+    return [i = from, to]() mutable -> std::optional<int> {
+        if (i >= to) {
+            return std::nullopt;
+        }
+        return i++;
+    };
+}
+
+// 异步 handler: 在其他线程中稍后应答
+void delay_add(trpc::Responder responder, int a, int b) {
+    std::thread([responder = std::move(responder), a, b]() mutable {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        responder.done(a + b);
+    }).detach();
+}
+
 int main() {
     clog::setLogLevel(clog::LogLevel::INFO);
     trpc::RpcServer server(6666, 2);
@@ -42,5 +95,14 @@ int main() {
     server.register_handler("get_fun", get_fun);
     server.register_handler("get_fun_name", get_fun_name);
     server.register_handler("print", &Fun::print, &f);
+    server.register_handler("byte_count", byte_count);
+    server.register_handler("move_point", move_point);
+    server.register_handler("sum", sum);
+    // 服务端默认不压缩响应, 单独为 repeat 开启 (客户端也开启压缩时才生效)
+    trpc::HandlerOptions compressed;
+    compressed.compression = trpc::Compression::ENABLED;
+    server.register_handler("repeat", repeat, compressed);
+    server.register_async_handler("delay_add", delay_add);
+    server.register_stream_handler("count_up", count_up);
     server.run();
 }
\ No newline at end of file
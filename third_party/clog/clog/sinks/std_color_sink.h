@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+
 #include "clog/details/log_msg.h"
 #include "clog/formatter.h"
 #include "clog/sinks/console_mutex.h"